@@ -0,0 +1,27 @@
+// Batched subtyping. A large check spends most of its time waiting on cache
+// misses while chasing continuations and probing sigma. subtype_batch keeps
+// several independent checks in flight on one thread: after each step it
+// prefetches what that check touches next and moves on to another check, so
+// the loads overlap instead of stalling one after the other.
+
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include <vector>
+#include <utility>
+
+#include "type.hpp"
+#include "resumable.hpp"
+#include "cancel.hpp"
+#include "result_store.hpp"
+
+using Query = std::pair<Type*, Type*>;
+
+// Verdict of every query, in order. width is the number of checks
+// interleaved at a time; 1 runs them one after another on the same
+// explicit-stack engine. Queries left unfinished when cancel is set are
+// Unknown. With a store, queries it has a verdict for are not checked, and
+// the verdicts of the others are added to it.
+std::vector<Verdict> subtype_batch(const std::vector<Query> &queries, bool inductive = false, int width = 4, const CancelToken *cancel = nullptr, ResultStore *store = nullptr);
+
+#endif // BATCH_HPP
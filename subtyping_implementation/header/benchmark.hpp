@@ -0,0 +1,102 @@
+// Benchmark harness: runs measurements on a persistent, optionally pinned,
+// worker thread and summarises repeated trials.
+
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <ostream>
+#include <utility>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+#include "cancel.hpp"
+#include "stats.hpp"
+
+const long long ONE_SECOND = 1'000'000'000;
+
+struct BenchmarkConfig {
+    long long timeout = 10 * ONE_SECOND; // per trial, in nanoseconds
+    int warmup = 1;
+    int trials = 5;
+};
+
+struct Measurement {
+    bool success = true; // false if any trial or warm-up run timed out
+    // Nanoseconds, one per trial run, the last of which may have timed out;
+    // empty if a warm-up run timed out.
+    std::vector<long long> samples;
+    long long min = 0;
+    long long median = 0;
+    long long p99 = 0;
+    SubtypeStats stats; // from an extra, untimed run after the trials, if built with STATS=1
+    HardwareCounters counters; // from the last trial
+};
+
+class BenchmarkRunner {
+    public:
+    // stats is non-null only on an extra run after the trials, so counting
+    // never skews the samples.
+    using Job = std::function<bool(const CancelToken &timeout_handler, SubtypeStats *stats)>;
+
+    // cpu < 0 leaves the worker unpinned.
+    explicit BenchmarkRunner(int cpu = -1);
+    ~BenchmarkRunner();
+
+    BenchmarkRunner(const BenchmarkRunner&) = delete;
+    BenchmarkRunner& operator=(const BenchmarkRunner&) = delete;
+
+    Measurement measure(const Job &job, const BenchmarkConfig &config);
+
+    private:
+    // Runs job once on the worker; returns false on timeout.
+    bool run_once(const Job &job, long long timeout, SubtypeStats *stats, long long &time_taken);
+    void worker_loop();
+
+#ifdef __linux__
+    // Runs worker_loop on a pthread, which unlike std::thread takes a stack size.
+    static void* run_worker(void *runner);
+    pthread_t worker;
+#else
+    std::thread worker;
+#endif
+    std::mutex m;
+    std::condition_variable cv;
+    CancelToken timeout_handler{false};
+    const Job *pending = nullptr;
+    SubtypeStats *pending_stats = nullptr;
+    bool done = false;
+    bool shutdown = false;
+    long long last_time = 0;
+    HardwareCounters last_counters;
+};
+
+// Writes rows in the `algorithm,k,success,time` layout read by plot.py,
+// followed by the per-trial statistics, the raw samples and the counters.
+// time is the median trial; counters that were not collected are left empty.
+// Metadata goes into leading `# key: value` lines (CSV) or a "metadata"
+// object (JSON).
+class ResultWriter {
+    public:
+    enum Format { CSV, JSON };
+    using Metadata = std::vector<std::pair<std::string, std::string>>;
+
+    ResultWriter(std::ostream &out, Format format, const Metadata &metadata = Metadata());
+    ~ResultWriter();
+
+    void write(const std::string &algorithm, long long k, const Measurement &measurement);
+
+    private:
+    std::ostream &out;
+    Format format;
+    bool first_row = true;
+};
+
+#endif // BENCHMARK_HPP
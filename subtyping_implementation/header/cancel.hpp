@@ -0,0 +1,9 @@
+#ifndef CANCEL_HPP
+#define CANCEL_HPP
+
+#include <atomic>
+
+// Cooperative cancellation flag, polled by the subtyping engines.
+using CancelToken = std::atomic<bool>;
+
+#endif
@@ -0,0 +1,22 @@
+// Compaction of a type's node arena. Nodes that are no longer reachable from
+// the root (left behind by edits or by unfold_once) are dropped, and the rest
+// are reallocated in DFS preorder from the root, so that a node and its first
+// continuation are usually neighbours in memory.
+
+#ifndef COMPACT_HPP
+#define COMPACT_HPP
+
+#include <cstddef>
+
+#include "type.hpp"
+
+struct CompactionReport {
+    std::size_t nodes_before;
+    std::size_t nodes_after;
+};
+
+// Compacts t in place. Every node of t is replaced, so outstanding pointers
+// into t are invalidated.
+CompactionReport compact(Type &t);
+
+#endif // COMPACT_HPP
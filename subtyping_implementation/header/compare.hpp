@@ -0,0 +1,20 @@
+// Compares two CSV result files written by the benchmark suites and flags
+// statistically significant slowdowns of the current run against a baseline.
+// Results written with --json cannot be compared.
+
+#ifndef COMPARE_HPP
+#define COMPARE_HPP
+
+#include <string>
+#include <ostream>
+
+struct CompareOptions {
+    double alpha = 0.05; // one-sided significance level of the Mann-Whitney U test
+    double threshold = 0.05; // minimum relative slowdown of the median worth reporting
+};
+
+// Prints a per-row report and returns the number of regressions, or -1 if a
+// file could not be read or is not a well-formed CSV result file.
+int compare_results(const std::string &baseline_path, const std::string &current_path, const CompareOptions &options, std::ostream &out);
+
+#endif // COMPARE_HPP
@@ -0,0 +1,28 @@
+// Registry of the available subtyping engines, so that drivers can select
+// them by name and run all of them side by side.
+
+#ifndef ENGINES_HPP
+#define ENGINES_HPP
+
+#include <string>
+#include <vector>
+
+#include "type.hpp"
+#include "cancel.hpp"
+#include "stats.hpp"
+
+struct Engine {
+    std::string name;
+    bool (*subtype)(Type &t1, Type &t2, const CancelToken &timeout_handler, SubtypeStats *stats);
+    bool recursive = false; // a stack frame for every pair on the current path
+    // Only there to cross-check other code against the engines (fuzz), so
+    // the suites skip it unless it is asked for by name.
+    bool cross_check_only = false;
+};
+
+const std::vector<Engine>& engines();
+
+// Returns nullptr if no engine has this name.
+const Engine* find_engine(const std::string &name);
+
+#endif // ENGINES_HPP
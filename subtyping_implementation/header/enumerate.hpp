@@ -0,0 +1,34 @@
+// Exhaustive enumeration of small types, for covering every shape up to a
+// size instead of sampling. Only types whose nodes are all reachable from the
+// root are produced, and only one of each isomorphism class: nodes are
+// numbered in BFS order from the root, taking the edges of a node in label
+// order, and an edge may only lead to a node already numbered or to the next
+// number. Every reachable type has exactly one such numbering, so no
+// duplicate is ever built and nothing has to be compared afterwards.
+//
+// Participants are numbered by first use in the same way unless
+// participant_symmetry is off, so types that only differ by a renaming of
+// participants are produced once.
+
+#ifndef ENUMERATE_HPP
+#define ENUMERATE_HPP
+
+#include <functional>
+
+#include "type.hpp"
+
+struct EnumerationBounds {
+    int nodes = 4;
+    int labels = 2; // choices use non-empty subsets of labels 0..labels-1
+    int participants = 2;
+    bool participant_symmetry = true;
+};
+
+const int MAX_ENUMERATED_LABELS = 16;
+
+// Calls visit once for every type within bounds, from threads workers (0 uses
+// every core) at once, with the number of the calling worker. The type is
+// only valid during the call. Returns the number of types.
+unsigned long long enumerate_types(const EnumerationBounds &bounds, const std::function<void(Type &t, unsigned worker)> &visit, unsigned threads = 0);
+
+#endif // ENUMERATE_HPP
@@ -95,9 +95,7 @@ namespace graph {
 
         GraphNode* copy() override {
             Branch* new_node = new Branch(participant);
-            for(auto &branch : branches) {
-                new_node->branches.push_back({branch.first, branch.second});
-            }
+            new_node->branches = branches;
             return new_node;
         }
     };
@@ -115,9 +113,7 @@ namespace graph {
 
         GraphNode* copy() override {
             Select* new_node = new Select(participant);
-            for(auto &branch : branches) {
-                new_node->branches.push_back({branch.first, branch.second});
-            }
+            new_node->branches = branches;
             return new_node;
         }
     };
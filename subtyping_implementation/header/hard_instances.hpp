@@ -0,0 +1,34 @@
+// Parameterized adversarial families for scaling studies. Every family is
+// driven by a single knob n and has a known answer, so that the asymptotic
+// behaviour of each engine can be charted and checked.
+
+#ifndef HARD_INSTANCES_HPP
+#define HARD_INSTANCES_HPP
+
+#include <string>
+#include <vector>
+
+#include "type.hpp"
+
+struct HardInstance {
+    Type sub;
+    Type super;
+    bool expected; // whether sub is a subtype of super
+};
+
+struct HardFamily {
+    std::string name;
+    std::string description;
+    HardInstance (*make)(int n);
+    int default_max; // largest n that stays within the default benchmark timeout
+    // Largest n the recursive engines take on the benchmark worker's stack,
+    // 0 if their depth stays small.
+    int recursive_max = 0;
+};
+
+const std::vector<HardFamily>& hard_families();
+
+// Returns nullptr if no family has this name.
+const HardFamily* find_hard_family(const std::string &name);
+
+#endif // HARD_INSTANCES_HPP
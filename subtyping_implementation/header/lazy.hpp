@@ -0,0 +1,99 @@
+// Lazily lowered types. A LazyType turns an AST into graph nodes as a check
+// reaches them instead of all at once as parse_ast does, so a query that fails
+// early on a huge input only pays for the part it explored.
+//
+// Every AST node other than Mu and Var becomes exactly one graph node, as in
+// parse_ast. A node is created without its continuations but with a pointer
+// back to its AST node; expand() creates the continuations (unexpanded in
+// turn) the first time the checker needs them. Mu binders are recorded in a
+// persistent environment, a list of frames shared by every node below the
+// binder, and a Var resolves to the node its Mu is bound to.
+
+#ifndef LAZY_HPP
+#define LAZY_HPP
+
+#include <deque>
+#include <cstddef>
+
+#include "ast.hpp"
+#include "graph.hpp"
+#include "type.hpp"
+#include "cancel.hpp"
+#include "stats.hpp"
+
+class LazyType {
+    public:
+    // Only the root is created. The AST must outlive the LazyType.
+    explicit LazyType(ast::ASTNode *ast);
+
+    LazyType(const LazyType&) = delete;
+    LazyType& operator=(const LazyType&) = delete;
+
+    // Creates the continuations of node if it has not been expanded yet. The
+    // typed overloads save dispatching on the kind of the node.
+    void expand(graph::GraphNode *node) {
+        Source *s = source(node);
+        if(s != nullptr && s->ast != nullptr) expand(node, *s);
+    }
+    void expand(graph::In *node) { expand_lowered(node); }
+    void expand(graph::Out *node) { expand_lowered(node); }
+    void expand(graph::Branch *node) { expand_lowered(node); }
+    void expand(graph::Select *node) { expand_lowered(node); }
+    // Expands everything, after which type() equals parse_ast of the AST.
+    void expand_all();
+
+    // The nodes created so far. Continuations of unexpanded nodes are null.
+    Type& type() { return t; }
+    std::size_t materialized() const { return t.nodes.size(); }
+
+    private:
+    // Binding of a Mu variable, with the frame of the enclosing binders.
+    struct Frame {
+        ast::TVar var;
+        graph::GraphNode *node;
+        const Frame *parent;
+    };
+
+    // Where a node came from; ast is reset once the node is expanded.
+    struct Source {
+        ast::ASTNode *ast;
+        const Frame *env;
+    };
+
+    // Nodes other than End are created as Lowered, so that expanding one
+    // needs no lookup.
+    template <typename Node>
+    struct Lowered : Node, Source {
+        Lowered(Participant participant, Source source) : Node(participant), Source(source) {}
+    };
+
+    static Source* source(graph::GraphNode *node) {
+        switch(node->type()) {
+            case graph::TypeIn: return static_cast<Lowered<graph::In>*>(node);
+            case graph::TypeOut: return static_cast<Lowered<graph::Out>*>(node);
+            case graph::TypeBranch: return static_cast<Lowered<graph::Branch>*>(node);
+            case graph::TypeSelect: return static_cast<Lowered<graph::Select>*>(node);
+            case graph::TypeEnd: return nullptr;
+        }
+        return nullptr;
+    }
+
+    template <typename Node>
+    void expand_lowered(Node *node) {
+        auto lowered = static_cast<Lowered<Node>*>(node);
+        if(lowered->ast != nullptr) expand(node, *lowered);
+    }
+
+    graph::GraphNode* materialize(ast::ASTNode *ast_node, const Frame *env);
+    void expand(graph::GraphNode *node, Source &source);
+
+    Type t;
+    std::deque<Frame> frames;
+};
+
+namespace coinductive_sub {
+    // Coinductive check of two lazily lowered types; t1 and t2 may be the same.
+    bool subtype(LazyType &t1, LazyType &t2, const CancelToken &timeout_handler, SubtypeStats *stats = nullptr);
+}
+
+#endif // LAZY_HPP
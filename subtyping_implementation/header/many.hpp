@@ -0,0 +1,38 @@
+// One subtype checked against many supertypes at once. Checking t1 against N
+// supertypes one by one walks t1 N times, even where the supertypes agree.
+// subtype_many first merges the nodes of all supertypes that no check can
+// tell apart (bisimilar nodes, found by partition refinement), so structure
+// shared by several supertypes becomes a single class, and then explores the
+// pairs (node of t1, class) once for all of them. Pairs proved or refuted for
+// one supertype are reused by the others, so the work scales with the number
+// of distinct product states rather than with N.
+//
+// A supertype stays alive until its root pair is refuted; it is dropped as
+// soon as that happens, and the pairs only it needed are not explored.
+//
+// Merging reads every node of every supertype once. That is cheap when the
+// supertypes share nodes, e.g. versions of one type or views of its states,
+// but supertypes that are separate copies of each other cost about as much
+// to merge as to check one by one.
+
+#ifndef MANY_HPP
+#define MANY_HPP
+
+#include <vector>
+#include <cstddef>
+
+#include "type.hpp"
+#include "cancel.hpp"
+#include "resumable.hpp"
+
+struct ManyStats {
+    std::size_t super_nodes = 0; // reachable nodes of all supertypes
+    std::size_t classes = 0; // after merging bisimilar nodes
+    std::size_t pairs = 0; // product states explored
+};
+
+// Whether t1 <= supers[i] for every i, as coinductive_sub::subtype decides.
+// Supertypes left undecided when cancel is set are Unknown.
+std::vector<Verdict> subtype_many(Type &t1, const std::vector<Type*> &supers, const CancelToken *cancel = nullptr, ManyStats *stats = nullptr);
+
+#endif // MANY_HPP
@@ -0,0 +1,112 @@
+// Contracts compiled into tables, for checking many candidate subtypes against
+// one fixed supertype. Compiling walks the contract once and numbers its
+// reachable nodes (states); each state records its kind, participant, the
+// candidate payload sorts it allows, a bitmap of its labels and a dense row
+// of its transitions by label. A check flattens the candidate into arrays the
+// same way, and the coinductive rules then run on the tables alone, with no
+// virtual calls and no label merging. The contract tables are read-only and
+// shared by every check, so they stay in cache from one candidate to the next.
+
+#ifndef MATCHER_HPP
+#define MATCHER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+
+#include "type.hpp"
+#include "graph.hpp"
+#include "cancel.hpp"
+#include "pair_set.hpp"
+
+class CompiledContract {
+    public:
+    // The contract is not referenced after compiling. The transition table
+    // takes states * labels entries.
+    explicit CompiledContract(const Type &contract);
+
+    // Whether candidate <= contract, as coinductive_sub::subtype decides;
+    // false if cancelled. Checks reuse scratch space, so one matcher must not
+    // be used by several threads at once.
+    bool subtype(const Type &candidate, const CancelToken &timeout_handler);
+
+    std::size_t states() const { return state_table.size(); }
+    std::size_t labels() const { return label_ids.size(); }
+    std::size_t table_bytes() const;
+
+    private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct State {
+        uint8_t kind; // graph::NodeType
+        uint8_t sorts; // bit s set if a candidate payload of sort s is allowed
+        Participant participant;
+        uint32_t label_count;
+        uint32_t next; // continuation of In and Out
+    };
+
+    struct CandidateNode {
+        uint8_t kind;
+        uint8_t sort; // payload of In and Out
+        Participant participant;
+        uint32_t first_edge;
+        uint32_t edge_count;
+    };
+
+    struct Edge {
+        uint32_t label; // dense id of a contract label, NONE if the contract has none
+        uint32_t target;
+    };
+
+    // Set of (candidate node, state) pairs, the sigma of a check: a bitmap
+    // over all pairs when that is small enough, an open-addressing hash set
+    // otherwise. Only the words set by the last check are cleared.
+    class PairMarks {
+        public:
+        void reset(std::size_t candidates, std::size_t states);
+        // False if the pair was already present.
+        bool insert(uint32_t c, uint32_t s) {
+            if(!dense) return insert_hashed(uint64_t(c) << 32 | s);
+            uint64_t bit = uint64_t(c) * states + s;
+            uint64_t &word = words[bit / 64], mask = uint64_t(1) << (bit % 64);
+            if(word & mask) return false;
+            if(word == 0) dirty.push_back(bit / 64);
+            word |= mask;
+            return true;
+        }
+
+        private:
+        bool insert_hashed(uint64_t key);
+        void grow();
+
+        bool dense = true;
+        std::size_t states = 0;
+        std::vector<uint64_t> words;
+        std::vector<std::size_t> dirty; // words set since the last reset
+        std::vector<uint64_t> slots; // EMPTY marks a free slot
+        std::size_t count = 0;
+    };
+
+    bool has_label(uint32_t state, uint32_t label) const {
+        return bitmaps[state * label_words + label / 64] >> (label % 64) & 1;
+    }
+    void flatten(const Type &candidate);
+
+    // Contract tables.
+    std::vector<State> state_table;
+    std::vector<uint64_t> bitmaps; // label_words per state
+    std::vector<uint32_t> transitions; // labels() per state, NONE where absent
+    std::unordered_map<graph::Label, uint32_t> label_ids;
+    std::size_t label_words;
+
+    // Scratch for checks.
+    std::vector<CandidateNode> candidate_nodes;
+    std::vector<Edge> candidate_edges;
+    NodeIds candidate_ids;
+    std::vector<graph::GraphNode*> order;
+    PairMarks sigma;
+    std::vector<std::pair<uint32_t, uint32_t>> todo;
+};
+
+#endif // MATCHER_HPP
@@ -0,0 +1,96 @@
+// Per-query memory accounting for the subtyping engines. A MemoryBudget
+// tracks the bytes held by a check (the input types, sigma and the recursion
+// stack) and can enforce a hard cap, so that a runaway query ends with an
+// "out of budget" result instead of exhausting the machine.
+
+#ifndef MEMORY_HPP
+#define MEMORY_HPP
+
+#include <cstddef>
+#include <new>
+#include <memory>
+
+#include "type.hpp"
+
+// Thrown by MemoryBudget when a charge would exceed the limit. Derives from
+// std::bad_alloc so that containers treat it as an ordinary allocation failure.
+struct MemoryBudgetExceeded : std::bad_alloc {
+    const char* what() const noexcept override { return "memory budget exceeded"; }
+};
+
+class MemoryBudget {
+    public:
+    // limit == 0 only accounts, it never aborts.
+    explicit MemoryBudget(std::size_t limit = 0) : limit(limit) {}
+
+    // Starts a new query: clears the counters and records the stack base.
+    void begin_query(const void *stack_base);
+    // Ends the query; peaks are kept until the next begin_query.
+    void end_query();
+
+    void charge(std::size_t bytes);
+    void release(std::size_t bytes);
+    // Records the current stack depth, given the address of a local.
+    void note_stack(const void *marker);
+
+    std::size_t current() const { return heap_bytes + stack_bytes; }
+    std::size_t peak() const { return peak_bytes; }
+    std::size_t peak_heap() const { return peak_heap_bytes; }
+    std::size_t peak_stack() const { return peak_stack_bytes; }
+    bool exceeded() const { return was_exceeded; }
+
+    std::size_t limit;
+
+    private:
+    void update_peak();
+
+    const char *stack_base = nullptr;
+    std::size_t heap_bytes = 0;
+    std::size_t stack_bytes = 0;
+    std::size_t peak_bytes = 0;
+    std::size_t peak_heap_bytes = 0;
+    std::size_t peak_stack_bytes = 0;
+    bool was_exceeded = false;
+};
+
+// Allocator that charges every allocation to a MemoryBudget. A null budget
+// makes it behave like std::allocator.
+template <typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    MemoryBudget *budget;
+
+    CountingAllocator(MemoryBudget *budget = nullptr) : budget(budget) {}
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U> &other) : budget(other.budget) {}
+
+    T* allocate(std::size_t n) {
+        if(budget) budget->charge(n * sizeof(T));
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T *p, std::size_t n) {
+        if(budget) budget->release(n * sizeof(T));
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U> &other) const { return budget == other.budget; }
+
+    template <typename U>
+    bool operator!=(const CountingAllocator<U> &other) const { return budget != other.budget; }
+};
+
+// Estimated heap bytes held by a type: its node vector, the nodes and their
+// branch vectors.
+std::size_t type_footprint(const Type &t);
+
+enum class MemoryCheckResult {
+    NotSubtype = 0,
+    Subtype = 1,
+    OutOfBudget = 2,
+};
+
+#endif // MEMORY_HPP
@@ -0,0 +1,93 @@
+// Set of (subtype node, supertype node) pairs, the sigma of the engines.
+
+#ifndef PAIR_SET_HPP
+#define PAIR_SET_HPP
+
+#include <cstdint>
+#include <utility>
+#include <functional>
+#include <unordered_set>
+#include <vector>
+
+#include "graph.hpp"
+#include "memory.hpp"
+
+int64_t splitmix64(int64_t state);
+
+using NodePair = std::pair<graph::GraphNode*, graph::GraphNode*>;
+
+struct PairHash {
+    std::size_t operator() (const NodePair& p) const {
+        int64_t a = reinterpret_cast<int64_t>(p.first);
+        int64_t b = reinterpret_cast<int64_t>(p.second);
+        // Both halves are mixed into every bit, so a table masking off the
+        // low bits does not home all pairs with one supertype node together.
+        return splitmix64(splitmix64(a) ^ b);
+    }
+};
+
+using PairSet = std::unordered_set<NodePair, PairHash, std::equal_to<NodePair>, CountingAllocator<NodePair>>;
+
+// Open-addressing (linear probing) pair set, used by the explicit-stack
+// engine. It does not allocate per insertion, and the slot a lookup starts at
+// is known up front, so interleaving drivers can prefetch it.
+class FlatPairSet {
+    public:
+    bool contains(const NodePair &p) const {
+        if(count == 0) return false;
+        for(std::size_t i = home(p); slots[i].first != nullptr; i = (i + 1) & mask()) {
+            if(slots[i] == p) return true;
+        }
+        return false;
+    }
+
+    // False if p was already present.
+    bool insert(const NodePair &p) {
+        if(2 * (count + 1) > slots.size()) grow();
+        std::size_t i = home(p);
+        for(; slots[i].first != nullptr; i = (i + 1) & mask()) {
+            if(slots[i] == p) return false;
+        }
+        slots[i] = p;
+        count++;
+        return true;
+    }
+
+    void erase(const NodePair &p);
+
+    std::size_t size() const { return count; }
+
+    // Address of the first slot a lookup of p probes.
+    const void* probe_address(const NodePair &p) const {
+        return slots.empty() ? nullptr : &slots[home(p)];
+    }
+
+    private:
+    std::size_t mask() const { return slots.size() - 1; }
+    std::size_t home(const NodePair &p) const { return PairHash()(p) & mask(); }
+    void grow();
+
+    std::vector<NodePair> slots; // {nullptr, nullptr} marks a free slot
+    std::size_t count = 0;
+};
+
+// Numbering of nodes in order of discovery, by an open-addressing table that
+// can be cleared and reused.
+class NodeIds {
+    public:
+    // Number of node, giving it the next one and appending it to order if it
+    // has none yet.
+    uint32_t number(graph::GraphNode *node, std::vector<graph::GraphNode*> &order);
+    // Makes room for n nodes, so numbering them never rehashes.
+    void reserve(std::size_t n);
+    void clear();
+
+    private:
+    void grow();
+    void rehash(std::size_t size);
+
+    std::vector<std::pair<graph::GraphNode*, uint32_t>> slots; // nullptr marks a free slot
+    std::size_t count = 0;
+};
+
+#endif // PAIR_SET_HPP
@@ -0,0 +1,76 @@
+// Opt-in memo of coinductive subtyping results across calls, for callers that
+// check the same pairs of types over and over. For each pair of types it
+// keeps the node pairs earlier checks proved or refuted (KnownPairs), so a
+// repeated query is answered by one lookup and a query that cannot be
+// answered still reuses the sub-pairs.
+//
+// Types are identified by address, so the cache must be told when a type is
+// changed or destroyed. It is not thread-safe.
+
+#ifndef RESULT_CACHE_HPP
+#define RESULT_CACHE_HPP
+
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+
+#include "type.hpp"
+#include "graph.hpp"
+#include "cancel.hpp"
+#include "stats.hpp"
+#include "subtyping.hpp"
+
+class ResultCache {
+    public:
+    // capacity bounds the node pairs kept over all type pairs; the least
+    // recently checked type pairs are dropped first.
+    explicit ResultCache(std::size_t capacity = 1 << 20) : capacity(capacity) {}
+
+    // Coinductive check of t1 <= t2.
+    bool subtype(Type &t1, Type &t2, const CancelToken &timeout_handler, SubtypeStats *stats = nullptr);
+
+    // Forgets everything about t. Must be called before t is changed or
+    // destroyed.
+    void invalidate(const Type &t);
+    // Forgets what may depend on the given nodes of t, which have been changed
+    // or created: pairs whose node in t can reach one of them, and pairs whose
+    // node is no longer in t. Must be called right after the change, before t
+    // is checked again. Created nodes must be listed even though the cache
+    // has never seen them: one may have the address of a deleted node, whose
+    // pairs would otherwise be taken for its own. Deleted nodes may be listed
+    // or left out.
+    void invalidate(const Type &t, const std::vector<graph::GraphNode*> &changed);
+
+    void clear();
+
+    std::size_t size() const { return stored; } // node pairs held
+    unsigned long long hits() const { return hit_count; } // answered without a check
+    unsigned long long misses() const { return miss_count; }
+
+    private:
+    struct Entry {
+        const Type *t1;
+        const Type *t2;
+        KnownPairs known;
+    };
+
+    using Key = std::pair<const Type*, const Type*>;
+
+    struct KeyHash {
+        std::size_t operator() (const Key &k) const {
+            return (splitmix64(reinterpret_cast<int64_t>(k.first)) << 32) ^ splitmix64(reinterpret_cast<int64_t>(k.second));
+        }
+    };
+
+    void erase(std::list<Entry>::iterator it);
+
+    std::size_t capacity;
+    std::size_t stored = 0;
+    std::list<Entry> entries; // most recently used first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+    unsigned long long hit_count = 0;
+    unsigned long long miss_count = 0;
+};
+
+#endif // RESULT_CACHE_HPP
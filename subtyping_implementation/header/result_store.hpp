@@ -0,0 +1,85 @@
+// Persistent store of subtyping verdicts, for jobs that re-check mostly the
+// same pairs of types from one run to the next. Verdicts are keyed by the
+// canonical hashes of the two types (type_hash.hpp), so a pair is found
+// again however it was built or loaded.
+//
+// The file is append-only: a header holding the engine version the verdicts
+// were computed with, then fixed-size records in host byte order. The file
+// stays mapped while the store is open, and lookups compare keys through the
+// mapping. The index is a flat table of record numbers, rebuilt at open by
+// one probe per record, so opening costs no allocation per record but is
+// still linear in the size of the file. A file from another engine version
+// is started afresh, and a torn record at the end, left by a run that was
+// killed while appending, is cut off. A file that is not a store is never
+// touched. Every verdict added is appended at once, so a run keeps what it
+// found up to the point it stopped.
+//
+// A store is not thread-safe, and only one process may have a file open.
+
+#ifndef RESULT_STORE_HPP
+#define RESULT_STORE_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "type.hpp"
+#include "type_hash.hpp"
+#include "resumable.hpp"
+#include "cancel.hpp"
+#include "stats.hpp"
+
+// Bump whenever a change to an engine, or to canonical_hash, could change
+// a verdict, so that stores written before it are not trusted.
+const uint64_t ENGINE_VERSION = 1;
+
+class ResultStore {
+    public:
+    explicit ResultStore(const std::string &path, uint64_t engine_version = ENGINE_VERSION);
+    ~ResultStore();
+
+    ResultStore(const ResultStore&) = delete;
+    ResultStore& operator=(const ResultStore&) = delete;
+
+    // False if the file could not be opened or created, or is not a store;
+    // the store is then empty and adding to it has no effect.
+    bool is_open() const { return fd >= 0; }
+
+    // Unknown if the pair has no verdict yet.
+    Verdict lookup(const TypeHash &t1, const TypeHash &t2);
+    // Records a Yes or No verdict; Unknown is ignored.
+    void add(const TypeHash &t1, const TypeHash &t2, Verdict verdict);
+
+    // Coinductive check of t1 <= t2, answered from the store if it has the
+    // verdict, and added to it otherwise unless cancelled.
+    bool subtype(Type &t1, Type &t2, const CancelToken &timeout_handler, SubtypeStats *stats = nullptr);
+
+    std::size_t size() const { return count; }
+    std::size_t loaded() const { return loaded_count; } // verdicts found in the file when opened
+    unsigned long long hits() const { return hit_count; }
+    unsigned long long misses() const { return miss_count; }
+
+    private:
+    struct Record;
+
+    const Record* record(uint32_t i) const;
+    // Slot of the key, or of the free slot where it would go.
+    std::size_t find(const TypeHash &t1, const TypeHash &t2) const;
+    void load(uint64_t engine_version);
+    bool map_records();
+    void grow_index();
+    void fail();
+
+    int fd = -1;
+    const char *map = nullptr;
+    std::size_t map_length = 0;
+    uint32_t records = 0; // whole records in the file
+    std::vector<uint32_t> slots; // record number + 1 of each key, 0 marks a free slot
+    std::size_t count = 0;
+    std::size_t loaded_count = 0;
+    unsigned long long hit_count = 0;
+    unsigned long long miss_count = 0;
+};
+
+#endif // RESULT_STORE_HPP
@@ -0,0 +1,75 @@
+// Step-budgeted subtyping. The engines are run on an explicit stack, so a
+// check that runs out of steps can hand back its exploration stack and sigma
+// and be resumed later with more budget, without redoing any work.
+
+#ifndef RESUMABLE_HPP
+#define RESUMABLE_HPP
+
+#include <memory>
+#include <vector>
+
+#include "type.hpp"
+#include "graph.hpp"
+#include "pair_set.hpp"
+
+enum class Verdict {
+    No = 0,
+    Yes = 1,
+    Unknown = 2,
+};
+
+// State of an unfinished check. The types it was started on must stay alive
+// and unmodified until it is resumed or dropped.
+class SuspendedCheck {
+    public:
+    unsigned long long steps_taken() const { return steps; }
+    std::size_t sigma_size() const { return sigma.size(); }
+    std::size_t stack_depth() const { return stack.size(); }
+
+    private:
+    friend struct ResumableEngine;
+
+    // A pair whose rule has been applied, with the position of the next
+    // child pair to check.
+    struct Frame {
+        graph::GraphNode *n1;
+        graph::GraphNode *n2;
+        std::size_t next; // next child of the driving side
+        std::size_t other; // label-merge position on the other side
+    };
+
+    bool inductive = false;
+    std::vector<Frame> stack;
+    FlatPairSet sigma;
+    NodePair pending = {nullptr, nullptr}; // pair to visit next, if any
+    unsigned long long steps = 0;
+};
+
+struct BudgetedResult {
+    Verdict verdict;
+    std::unique_ptr<SuspendedCheck> suspended; // set iff verdict == Unknown
+};
+
+namespace inductive_sub {
+    // Applies at most steps rules (one per visited pair) before suspending.
+    BudgetedResult subtype(Type &t1, Type &t2, unsigned long long steps);
+}
+
+namespace coinductive_sub {
+    // Applies at most steps rules (one per visited pair) before suspending.
+    BudgetedResult subtype(Type &t1, Type &t2, unsigned long long steps);
+}
+
+// Continues a suspended check with another steps rule applications.
+BudgetedResult resume(std::unique_ptr<SuspendedCheck> suspended, unsigned long long steps);
+
+// Lower-level interface for drivers that interleave many checks (see
+// batch.hpp). A check made by start_check has not taken any step yet.
+std::unique_ptr<SuspendedCheck> start_check(Type &t1, Type &t2, bool inductive);
+// Takes one step, returning Unknown while the check is still running.
+Verdict step(SuspendedCheck &check);
+// Steps check until it is about to visit a new pair, whose nodes and sigma
+// slot are then prefetched. Returns Unknown while the check is still running.
+Verdict run_to_next_pair(SuspendedCheck &check);
+
+#endif // RESUMABLE_HPP
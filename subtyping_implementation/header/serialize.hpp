@@ -0,0 +1,41 @@
+// Compact binary encoding of a Type, used to ship types to the subtyping
+// server. Nodes are numbered by their position in Type::nodes; integers are
+// stored in host byte order, so an encoding is only meant for the machine
+// that produced it.
+//
+//   u32 node count, u32 root index, then per node a u8 NodeType and
+//     In/Out:        i32 participant, u8 payload sort, u32 continuation
+//     Branch/Select: i32 participant, u32 label count, (i32 label, u32 target)*
+//     End:           nothing
+
+#ifndef SERIALIZE_HPP
+#define SERIALIZE_HPP
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+#include "type.hpp"
+
+// Appends the encoding of t to out.
+void serialize(const Type &t, std::string &out);
+
+// Decodes exactly size bytes into the empty type t. Returns false, leaving t
+// empty, if the data is truncated, has trailing bytes, refers to a node out
+// of range, or has unsorted or duplicate labels.
+bool deserialize(const char *data, std::size_t size, Type &t);
+
+// Streams of types, e.g. files of queries for the batch driver, are a
+// sequence of records: u32 length, then the encoding. Like server frames
+// (protocol::MAX_PAYLOAD), a record holds at most MAX_RECORD bytes, so a
+// corrupt length cannot make a reader allocate gigabytes.
+const uint32_t MAX_RECORD = 1u << 28;
+
+void write_type(std::ostream &out, const Type &t);
+
+// Reads the next record into the empty type t; false at the end of the
+// stream or on a malformed or oversized record.
+bool read_type(std::istream &in, Type &t);
+
+#endif // SERIALIZE_HPP
@@ -0,0 +1,94 @@
+// Long-running subtyping service over a Unix domain socket. Clients register
+// types once (see serialize.hpp) and then refer to them by ID, so a query
+// costs neither process startup nor rebuilding the types.
+//
+// Every request and response is a frame: u32 payload length, u32 tag, u8
+// code, payload. The tag is chosen by the client and echoed in the response.
+// Requests may be pipelined; responses can come back out of order, so
+// clients match them by tag. A client that stops reading responses only holds
+// up its own connection: once enough of them are queued, the server stops
+// reading its requests.
+//
+//   code          request payload     response payload (status Ok)
+//   Register      serialized type     u64 ID
+//   Subtype       u64 ID, u64 ID      u8 Verdict
+//   Equivalent    u64 ID, u64 ID      u8 Verdict
+//   Drop          u64 ID              empty
+//
+// Requests of one connection see the registry in the order they were sent.
+// IDs are never reused.
+//
+// With a store_path, a check that misses the in-memory cache is looked up in
+// a persistent result store by the canonical hashes of its types, and new
+// verdicts are added to it, so they survive a restart of the server.
+
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace protocol {
+    enum Op : uint8_t {
+        Register = 1,
+        Subtype = 2,
+        Equivalent = 3,
+        Drop = 4,
+    };
+
+    enum Status : uint8_t {
+        Ok = 0,
+        UnknownType = 1, // an ID that was never registered or was dropped
+        Malformed = 2,
+    };
+
+    const std::size_t HEADER_SIZE = 9;
+    const uint32_t MAX_PAYLOAD = 1u << 28;
+
+    struct Frame {
+        uint32_t tag = 0;
+        uint8_t code = 0; // Op in requests, Status in responses
+        std::string payload;
+    };
+
+    // Appends frame to out, for batching several frames into one write.
+    void encode(const Frame &frame, std::string &out);
+
+    // Writes all of data; false if the peer has gone away.
+    bool write_all(int fd, const std::string &data);
+
+    // Buffered frame reader over a socket.
+    class FrameReader {
+        public:
+        explicit FrameReader(int fd) : fd(fd) {}
+        // False on end of stream, error or an oversized frame.
+        bool next(Frame &frame);
+
+        private:
+        bool fill(std::size_t bytes);
+
+        int fd;
+        std::string buffer;
+        std::size_t pos = 0;
+    };
+
+    void put_id(std::string &out, uint64_t id);
+    // Reads the i-th ID of a payload; false if it is too short.
+    bool get_id(const std::string &payload, std::size_t i, uint64_t &id);
+}
+
+struct ServerOptions {
+    std::string socket_path;
+    int workers = 0; // 0 uses every core
+    unsigned long long max_steps = 0; // per subtype check, 0 is unlimited
+    std::size_t cache_capacity = 1 << 20; // cached verdicts
+    std::string store_path; // persistent result store (result_store.hpp), empty for none
+};
+
+// Listens on options.socket_path (replacing a stale socket, but no other kind
+// of file) and serves until the process is killed. Returns non-zero if the
+// socket cannot be set up.
+int serve(const ServerOptions &options);
+
+#endif // SERVER_HPP
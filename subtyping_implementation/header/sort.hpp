@@ -11,6 +11,9 @@ enum Sort {
 };
 
 std::wstring to_string(Sort sort);
-bool subsort(Sort s1, Sort s2);
+
+constexpr bool subsort(Sort s1, Sort s2) {
+    return s1 == s2 || (s1 == Nat && s2 == Int);
+}
 
 #endif
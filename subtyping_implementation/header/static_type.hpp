@@ -0,0 +1,334 @@
+// Session types fixed in C++ source, checked at compile time. The templates
+// below mirror ast.hpp:
+//
+//   using Server = Mu<0, Branch<1, Case<0, In<1, Nat, Var<0>>>,
+//                                  Case<1, End>>>;
+//   static_assert(subtype<Client, Server>());
+//
+// lower<T>() numbers the nodes of T in preorder (as parse_ast would create
+// them, with labels sorted) into a Table, at compile time. subtype() runs the
+// coinductive check on two such tables and is constexpr, and to_type<T>()
+// builds the runtime Type from the precomputed table without parsing.
+// Ill-formed descriptions (unbound or unguarded variables, repeated labels)
+// fail to compile wherever they are lowered in a constant expression.
+
+#ifndef STATIC_TYPE_HPP
+#define STATIC_TYPE_HPP
+
+#include <array>
+#include <cstddef>
+
+#include "ast.hpp"
+#include "graph.hpp"
+#include "sort.hpp"
+#include "participant.hpp"
+#include "type.hpp"
+
+namespace static_type {
+    using Label = graph::Label;
+    using TVar = ast::TVar;
+
+    struct End {};
+    template <Participant P, Sort S, typename K> struct In {};
+    template <Participant P, Sort S, typename K> struct Out {};
+    template <Label L, typename K> struct Case {
+        static constexpr Label label = L;
+        using Continuation = K;
+    };
+    template <Participant P, typename... Cases> struct Branch {};
+    template <Participant P, typename... Cases> struct Select {};
+    template <TVar X, typename Body> struct Mu {};
+    template <TVar X> struct Var {};
+
+    // Nodes, edges and Mu binders in a description.
+    template <typename T> struct Count;
+
+    template <> struct Count<End> {
+        static constexpr std::size_t nodes = 1, edges = 0, binders = 0;
+    };
+
+    template <Participant P, Sort S, typename K> struct Count<In<P, S, K>> {
+        static constexpr std::size_t nodes = 1 + Count<K>::nodes, edges = 1 + Count<K>::edges, binders = Count<K>::binders;
+    };
+
+    template <Participant P, Sort S, typename K> struct Count<Out<P, S, K>> {
+        static constexpr std::size_t nodes = 1 + Count<K>::nodes, edges = 1 + Count<K>::edges, binders = Count<K>::binders;
+    };
+
+    template <typename... K> struct CountCases {
+        static constexpr std::size_t nodes = 1 + (0 + ... + Count<K>::nodes);
+        static constexpr std::size_t edges = sizeof...(K) + (0 + ... + Count<K>::edges);
+        static constexpr std::size_t binders = (0 + ... + Count<K>::binders);
+    };
+
+    template <Participant P, typename... Cases> struct Count<Branch<P, Cases...>> : CountCases<typename Cases::Continuation...> {};
+    template <Participant P, typename... Cases> struct Count<Select<P, Cases...>> : CountCases<typename Cases::Continuation...> {};
+
+    template <TVar X, typename Body> struct Count<Mu<X, Body>> {
+        static constexpr std::size_t nodes = Count<Body>::nodes, edges = Count<Body>::edges, binders = 1 + Count<Body>::binders;
+    };
+
+    template <TVar X> struct Count<Var<X>> {
+        static constexpr std::size_t nodes = 0, edges = 0, binders = 0;
+    };
+
+    struct Node {
+        graph::NodeType kind = graph::TypeEnd;
+        Participant participant = 0;
+        Sort payload = Int;
+        std::size_t first_edge = 0;
+        std::size_t edge_count = 0;
+    };
+
+    struct Edge {
+        Label label = 0;
+        std::size_t target = 0;
+    };
+
+    // Nodes in preorder, the root first. Edges of a choice are sorted by label.
+    template <std::size_t N, std::size_t E>
+    struct Table {
+        std::array<Node, N> nodes{};
+        std::array<Edge, E> edges{};
+    };
+
+    template <std::size_t N, std::size_t E, std::size_t B>
+    struct Builder {
+        Table<N, E> table{};
+        std::size_t nodes = 0;
+        std::size_t edges = 0;
+        // Binders in scope, innermost last.
+        std::array<TVar, B> vars{};
+        std::array<std::size_t, B> bound{};
+        std::size_t binders = 0;
+
+        constexpr std::size_t add_node(graph::NodeType kind, Participant participant, Sort payload, std::size_t edge_count) {
+            table.nodes[nodes] = Node{kind, participant, payload, edges, edge_count};
+            edges += edge_count;
+            return nodes++;
+        }
+
+        constexpr std::size_t lookup(TVar var) const {
+            for(std::size_t i = binders; i-- > 0;) {
+                if(vars[i] == var) return bound[i];
+            }
+            throw "unbound variable";
+        }
+
+        constexpr void sort_edges(std::size_t node) {
+            std::size_t first = table.nodes[node].first_edge, last = first + table.nodes[node].edge_count;
+            for(std::size_t i = first + 1; i < last; i++) {
+                for(std::size_t j = i; j > first && table.edges[j - 1].label >= table.edges[j].label; j--) {
+                    if(table.edges[j - 1].label == table.edges[j].label) throw "repeated label";
+                    Edge swap = table.edges[j - 1];
+                    table.edges[j - 1] = table.edges[j];
+                    table.edges[j] = swap;
+                }
+            }
+        }
+    };
+
+    // Adds the nodes of T to a builder and returns the number of its first one.
+    template <typename T> struct Lower;
+
+    template <> struct Lower<End> {
+        template <typename B>
+        static constexpr std::size_t add(B &b) {
+            return b.add_node(graph::TypeEnd, 0, Int, 0);
+        }
+    };
+
+    template <Participant P, Sort S, typename K> struct Lower<In<P, S, K>> {
+        template <typename B>
+        static constexpr std::size_t add(B &b) {
+            std::size_t node = b.add_node(graph::TypeIn, P, S, 1);
+            std::size_t edge = b.table.nodes[node].first_edge;
+            b.table.edges[edge] = Edge{0, Lower<K>::add(b)};
+            return node;
+        }
+    };
+
+    template <Participant P, Sort S, typename K> struct Lower<Out<P, S, K>> {
+        template <typename B>
+        static constexpr std::size_t add(B &b) {
+            std::size_t node = b.add_node(graph::TypeOut, P, S, 1);
+            std::size_t edge = b.table.nodes[node].first_edge;
+            b.table.edges[edge] = Edge{0, Lower<K>::add(b)};
+            return node;
+        }
+    };
+
+    template <graph::NodeType Kind, Participant P, typename... Cases, typename B>
+    constexpr std::size_t add_choice(B &b) {
+        std::size_t node = b.add_node(Kind, P, Int, sizeof...(Cases));
+        std::size_t edge = b.table.nodes[node].first_edge;
+        ((b.table.edges[edge++] = Edge{Cases::label, Lower<typename Cases::Continuation>::add(b)}), ...);
+        b.sort_edges(node);
+        return node;
+    }
+
+    template <Participant P, typename... Cases> struct Lower<Branch<P, Cases...>> {
+        template <typename B>
+        static constexpr std::size_t add(B &b) {
+            return add_choice<graph::TypeBranch, P, Cases...>(b);
+        }
+    };
+
+    template <Participant P, typename... Cases> struct Lower<Select<P, Cases...>> {
+        template <typename B>
+        static constexpr std::size_t add(B &b) {
+            return add_choice<graph::TypeSelect, P, Cases...>(b);
+        }
+    };
+
+    template <TVar X, typename Body> struct Lower<Mu<X, Body>> {
+        template <typename B>
+        static constexpr std::size_t add(B &b) {
+            // X is bound to the first node of the body, which is created next.
+            std::size_t first = b.nodes;
+            b.vars[b.binders] = X;
+            b.bound[b.binders] = first;
+            b.binders++;
+            std::size_t node = Lower<Body>::add(b);
+            b.binders--;
+            if(b.nodes == first || node != first) throw "unguarded recursion";
+            return node;
+        }
+    };
+
+    template <TVar X> struct Lower<Var<X>> {
+        template <typename B>
+        static constexpr std::size_t add(B &b) {
+            return b.lookup(X);
+        }
+    };
+
+    template <typename T>
+    constexpr auto lower() {
+        Builder<Count<T>::nodes, Count<T>::edges, Count<T>::binders> b{};
+        Lower<T>::add(b);
+        return b.table;
+    }
+
+    // The table of T, computed once at compile time.
+    template <typename T>
+    inline constexpr auto table = lower<T>();
+
+    // Whether Sub <= Super, by the rules of coinductive_sub::subtype. Meant
+    // for constant expressions: it keeps one flag per pair of nodes.
+    template <typename Sub, typename Super>
+    constexpr bool subtype() {
+        const auto &t1 = table<Sub>;
+        const auto &t2 = table<Super>;
+        constexpr std::size_t N1 = Count<Sub>::nodes, N2 = Count<Super>::nodes;
+        std::array<bool, N1 * N2> seen{};
+        std::array<std::size_t, N1 * N2> todo{};
+        std::size_t top = 0;
+        auto visit = [&](std::size_t i, std::size_t j) {
+            if(!seen[i * N2 + j]) {
+                seen[i * N2 + j] = true;
+                todo[top++] = i * N2 + j;
+            }
+        };
+        visit(0, 0);
+        while(top > 0) {
+            std::size_t pair = todo[--top];
+            const Node &a = t1.nodes[pair / N2];
+            const Node &b = t2.nodes[pair % N2];
+            if(a.kind != b.kind) return false;
+            if(a.kind == graph::TypeEnd) continue; // AS-End
+            if(a.participant != b.participant) return false;
+            switch(a.kind) {
+                case graph::TypeIn: // AS-In
+                    if(!subsort(b.payload, a.payload)) return false;
+                    visit(t1.edges[a.first_edge].target, t2.edges[b.first_edge].target);
+                    break;
+                case graph::TypeOut: // AS-Out
+                    if(!subsort(a.payload, b.payload)) return false;
+                    visit(t1.edges[a.first_edge].target, t2.edges[b.first_edge].target);
+                    break;
+                case graph::TypeBranch: // AS-Branch: every label of a is in b
+                case graph::TypeSelect: { // AS-Select: every label of b is in a
+                    bool branch = a.kind == graph::TypeBranch;
+                    const Node &fewer = branch ? a : b, &more = branch ? b : a;
+                    const Edge *fewer_edges = branch ? t1.edges.data() : t2.edges.data();
+                    const Edge *more_edges = branch ? t2.edges.data() : t1.edges.data();
+                    std::size_t j = 0;
+                    for(std::size_t i = 0; i < fewer.edge_count; i++) {
+                        const Edge &edge = fewer_edges[fewer.first_edge + i];
+                        while(j < more.edge_count && more_edges[more.first_edge + j].label < edge.label) j++;
+                        if(j == more.edge_count || more_edges[more.first_edge + j].label != edge.label) return false;
+                        std::size_t target = more_edges[more.first_edge + j].target;
+                        if(branch) visit(edge.target, target);
+                        else visit(target, edge.target);
+                    }
+                    break;
+                }
+                case graph::TypeEnd:
+                    break;
+            }
+        }
+        return true;
+    }
+
+    // The runtime Type of T, built from its precomputed table.
+    template <typename T>
+    Type to_type() {
+        const auto &t = table<T>;
+        Type result;
+        result.nodes.reserve(t.nodes.size());
+        for(const Node &node : t.nodes) {
+            switch(node.kind) {
+                case graph::TypeIn: {
+                    graph::In *in = new graph::In(node.participant);
+                    in->payload = node.payload;
+                    result.nodes.push_back(in);
+                    break;
+                }
+                case graph::TypeOut: {
+                    graph::Out *out = new graph::Out(node.participant);
+                    out->payload = node.payload;
+                    result.nodes.push_back(out);
+                    break;
+                }
+                case graph::TypeBranch:
+                    result.nodes.push_back(new graph::Branch(node.participant));
+                    break;
+                case graph::TypeSelect:
+                    result.nodes.push_back(new graph::Select(node.participant));
+                    break;
+                case graph::TypeEnd:
+                    result.nodes.push_back(new graph::End());
+                    break;
+            }
+        }
+        for(std::size_t i = 0; i < t.nodes.size(); i++) {
+            const Node &node = t.nodes[i];
+            graph::GraphNode *target = node.edge_count > 0 ? result.nodes[t.edges[node.first_edge].target] : nullptr;
+            switch(node.kind) {
+                case graph::TypeIn:
+                    static_cast<graph::In*>(result.nodes[i])->continuation = target;
+                    break;
+                case graph::TypeOut:
+                    static_cast<graph::Out*>(result.nodes[i])->continuation = target;
+                    break;
+                case graph::TypeBranch:
+                case graph::TypeSelect: {
+                    auto &branches = node.kind == graph::TypeBranch ? static_cast<graph::Branch*>(result.nodes[i])->branches
+                                                                   : static_cast<graph::Select*>(result.nodes[i])->branches;
+                    branches.reserve(node.edge_count);
+                    for(std::size_t e = node.first_edge; e < node.first_edge + node.edge_count; e++) {
+                        branches.push_back({t.edges[e].label, result.nodes[t.edges[e].target]});
+                    }
+                    break;
+                }
+                case graph::TypeEnd:
+                    break;
+            }
+        }
+        result.root = result.nodes[0];
+        return result;
+    }
+}
+
+#endif // STATIC_TYPE_HPP
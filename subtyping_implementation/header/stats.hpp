@@ -0,0 +1,66 @@
+// Optional counters for the subtyping engines. They are only collected when
+// built with -DSUBTYPE_STATS (make STATS=1); otherwise STAT(...) expands to
+// nothing and the engines never touch the stats object.
+
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <cstddef>
+
+struct SubtypeStats {
+    enum Rule {
+        AS_In = 0,
+        AS_Out = 1,
+        AS_Branch = 2,
+        AS_Select = 3,
+        AS_Assump = 4,
+        AS_End = 5,
+        NUM_RULES = 6,
+    };
+
+    unsigned long long rules[NUM_RULES] = {};
+    unsigned long long sigma_inserts = 0;
+    unsigned long long sigma_erases = 0;
+    std::size_t peak_sigma = 0;
+    int max_depth = 0;
+    unsigned long long label_merge_steps = 0; // label comparisons while matching branches
+
+    void reset() { *this = SubtypeStats(); }
+};
+
+#ifdef SUBTYPE_STATS
+#define STATS_ENABLED 1
+#define STAT(stats, stmt) do { if(stats) { stmt; } } while(0)
+#else
+#define STATS_ENABLED 0
+#define STAT(stats, stmt) do {} while(0)
+#endif
+
+// Hardware counters for the calling thread, read through perf_event_open on
+// Linux. available is false when the kernel refuses access (or elsewhere).
+struct HardwareCounters {
+    bool available = false;
+    long long cycles = 0;
+    long long cache_misses = 0;
+    long long branch_misses = 0;
+};
+
+class PerfCounters {
+    public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const { return group_fd >= 0; }
+    void start();
+    HardwareCounters stop();
+
+    private:
+    int group_fd = -1;
+    int cache_fd = -1;
+    int branch_fd = -1;
+};
+
+#endif // STATS_HPP
@@ -0,0 +1,44 @@
+// Exploration strategies for the coinductive engine. The coinductive check
+// fails as soon as any reachable pair is refuted and never backtracks, so the
+// order in which pairs are visited does not change the verdict, only how soon
+// a refutation is found.
+//
+//   label-order  depth-first, children in label order (as check_rule does)
+//   bfs          breadth-first from the root pair
+//   shallowest   pairs closest to an end node first, by precomputed height
+//   cheapest     depth-first, but every child of a pair is checked locally
+//                before any of them is explored, and the child with the
+//                fewest continuations is explored first
+//
+// shallowest computes the heights for every check, in time linear in both
+// types; on large types that refute early this costs more than it saves.
+
+#ifndef STRATEGY_HPP
+#define STRATEGY_HPP
+
+#include <string>
+#include <vector>
+
+#include "type.hpp"
+#include "cancel.hpp"
+#include "stats.hpp"
+
+enum class Strategy {
+    LabelOrder,
+    BreadthFirst,
+    ShallowestFirst,
+    CheapestFirst,
+};
+
+const std::vector<Strategy>& all_strategies();
+const char* strategy_name(Strategy strategy);
+// Returns false if no strategy has this name.
+bool parse_strategy(const std::string &name, Strategy &strategy);
+
+namespace coinductive_sub {
+    // Worklist form of the coinductive check, visiting pairs in the order
+    // given by strategy.
+    bool subtype(Type &t1, Type &t2, Strategy strategy, const CancelToken &timeout_handler, SubtypeStats *stats = nullptr);
+}
+
+#endif // STRATEGY_HPP
@@ -2,13 +2,35 @@
 #define SUBTYPING_HPP
 
 #include "type.hpp"
+#include "cancel.hpp"
+#include "stats.hpp"
+#include "memory.hpp"
+#include "pair_set.hpp"
+
+#include <unordered_set>
+
+// Node pairs decided by earlier coinductive checks of the same two types (see
+// result_cache.hpp). Proven pairs are closed under the rules, so a check may
+// take them as given, as it does its own assumptions.
+struct KnownPairs {
+    std::unordered_set<NodePair, PairHash> holds;
+    std::unordered_set<NodePair, PairHash> fails;
+};
 
 namespace inductive_sub {
-    bool subtype(Type &t1, Type &t2, volatile bool &timeout_handler);
+    bool subtype(Type &t1, Type &t2, const CancelToken &timeout_handler, SubtypeStats *stats = nullptr);
+    // Accounts the check against budget; OutOfBudget if it would exceed the limit.
+    MemoryCheckResult subtype(Type &t1, Type &t2, const CancelToken &timeout_handler, MemoryBudget &budget, SubtypeStats *stats = nullptr);
 }
 
 namespace coinductive_sub {
-    bool subtype(Type &t1, Type &t2, volatile bool &timeout_handler);
+    bool subtype(Type &t1, Type &t2, const CancelToken &timeout_handler, SubtypeStats *stats = nullptr);
+    // Accounts the check against budget; OutOfBudget if it would exceed the limit.
+    MemoryCheckResult subtype(Type &t1, Type &t2, const CancelToken &timeout_handler, MemoryBudget &budget, SubtypeStats *stats = nullptr);
+    // Answers pairs found in known directly, and adds the pairs this check
+    // decides: all of sigma if it succeeds, the failing path if it does not.
+    // Nothing is added if the check is cancelled.
+    bool subtype(Type &t1, Type &t2, const CancelToken &timeout_handler, KnownPairs &known, SubtypeStats *stats = nullptr);
 }
 
 #endif
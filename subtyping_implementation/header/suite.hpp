@@ -0,0 +1,51 @@
+// Named, parameterized benchmark families. Each run writes one
+// self-describing result file (results_<name>.txt/.json) that records the
+// parameters, build flags and machine alongside the measurements.
+
+#ifndef SUITE_HPP
+#define SUITE_HPP
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <functional>
+
+#include "benchmark.hpp"
+#include "engines.hpp"
+
+struct SuiteOptions {
+    int size_min = 1;
+    int size_max = 10;
+    int size_step = 1;
+    int type_size = 0; // size of the generated types, for families indexed by sample
+    int iterations = 1; // subtype calls per trial
+    unsigned seed = 42;
+    std::vector<std::string> engines; // empty selects every engine but the cross-check-only ones
+    BenchmarkConfig config;
+};
+
+struct Suite {
+    std::string name;
+    std::string description;
+    SuiteOptions defaults;
+    // Runs the family for every k in the size range, writing one row per engine.
+    std::function<void(BenchmarkRunner &runner, const SuiteOptions &options, ResultWriter &out)> run;
+};
+
+// The fixed families, followed by one "hard-<family>" suite per hard
+// instance family.
+const std::vector<Suite>& benchmark_suites();
+
+// Returns nullptr if no suite has this name.
+const Suite* find_suite(const std::string &name);
+
+// File name plot.py expects, e.g. "results_worst_case.txt" for "worst-case".
+std::string result_file_name(const Suite &suite, ResultWriter::Format format);
+
+// Key/value pairs describing the suite parameters, build and machine.
+std::vector<std::pair<std::string, std::string>> run_metadata(const Suite &suite, const SuiteOptions &options);
+
+// Engines selected by options, in registry order.
+std::vector<const Engine*> selected_engines(const SuiteOptions &options);
+
+#endif // SUITE_HPP
@@ -0,0 +1,135 @@
+// Optional execution tracing for the recursive engines. Events are only
+// recorded when built with -DSUBTYPE_TRACE (make TRACE=1); otherwise
+// TRACE(...) expands to nothing. In a tracing build, a check records if its
+// thread was between trace::start() and trace::stop() when it began.
+//
+// Every visited pair gives an enter event (pair, depth, and the rule applied).
+// A pair is exited when the next event at its depth or above is recorded.
+// A failing pair fails every pair it is nested in, as the engines never
+// backtrack, so a failure is only stored where it starts, and otherwise only
+// the end of each check is. Nothing is recorded on the way back up, so the
+// engines pass the depth down instead of keeping it in the buffer, and an
+// untraced check runs the same code as in a build without tracing. Each
+// thread writes into its own ring buffer, which keeps the most recent events;
+// write_chrome_json exports them, with explicit begin/end pairs, in the
+// Chrome trace-event format (chrome://tracing, Perfetto). Reading the clock
+// costs about as much as a rule, so only every STAMP_INTERVAL-th event reads
+// it and the times in between are interpolated on export; a stamp then spans
+// a few microseconds of checking.
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <ostream>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "graph.hpp"
+
+namespace trace {
+    const uint64_t STAMP_INTERVAL = 256;
+
+    // One event in 16 bytes. Node addresses fit in the low 48 bits, as
+    // user-space addresses do on x86-64 and AArch64.
+    //   first:  n1 | depth << 48 (depth saturates at 0xffff)
+    //   second: n2 | (rule + 1) << 48 | exit << 52 | result << 53
+    // Exit events (a failure, or the end of a check at depth 0) carry only
+    // the depth, the exit bit and the result.
+    struct Event {
+        uint64_t first;
+        uint64_t second;
+
+        static const int SHIFT = 48;
+        static const uint64_t ADDRESS = (uint64_t(1) << SHIFT) - 1;
+        static const uint64_t EXIT = uint64_t(1) << (SHIFT + 4);
+        static const uint64_t RESULT = uint64_t(1) << (SHIFT + 5);
+
+        graph::GraphNode* n1() const { return reinterpret_cast<graph::GraphNode*>(first & ADDRESS); }
+        graph::GraphNode* n2() const { return reinterpret_cast<graph::GraphNode*>(second & ADDRESS); }
+        unsigned depth() const { return first >> SHIFT; }
+        int rule() const { return int((second >> SHIFT) & 0xf) - 1; } // SubtypeStats::Rule, -1 if none applied
+        bool exit() const { return second & EXIT; }
+        bool result() const { return second & RESULT; }
+    };
+
+    class Buffer {
+        public:
+        Buffer(std::size_t capacity, unsigned thread_id);
+
+        // Records entering the pair (n1, n2) at depth, and the rule applied.
+        void enter(graph::GraphNode *n1, graph::GraphNode *n2, unsigned depth, int rule) {
+            push({reinterpret_cast<uint64_t>(n1) | saturated(depth) << Event::SHIFT,
+                  reinterpret_cast<uint64_t>(n2) | uint64_t(rule + 1) << Event::SHIFT});
+        }
+        // Records that the pair entered last at depth fails.
+        void fail(unsigned depth) { push({saturated(depth) << Event::SHIFT, Event::EXIT}); }
+        // Records a pair at depth that fails because no rule applies to it.
+        void no_rule(graph::GraphNode *n1, graph::GraphNode *n2, unsigned depth) {
+            enter(n1, n2, depth, -1);
+            fail(depth);
+        }
+        // Records the end of a check.
+        void end(bool result) { push({0, Event::EXIT | (result ? Event::RESULT : 0)}); }
+
+        // Cheap timestamp: the TSC on x86, the steady clock elsewhere.
+        static uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+        }
+
+        private:
+        friend void stop();
+        friend void write_chrome_json(std::ostream &out);
+
+        static uint64_t saturated(unsigned depth) { return depth < 0xffff ? depth : 0xffff; }
+
+        void push(const Event &e) {
+            events[next & mask] = e;
+            if(next % STAMP_INTERVAL == 0) stamps[(next & mask) / STAMP_INTERVAL] = ticks();
+            next++;
+        }
+
+        std::vector<Event> events;
+        std::vector<uint64_t> stamps; // ticks of every STAMP_INTERVAL-th event
+        std::size_t mask;
+        uint64_t next = 0; // events recorded so far; the ring holds the last capacity
+        unsigned thread_id;
+        // Tick and clock readings at start and stop, to convert ticks to time.
+        uint64_t start_ticks, stop_ticks = 0;
+        std::chrono::steady_clock::time_point start_time, stop_time;
+    };
+
+    // Buffer of the calling thread while it is recording, nullptr otherwise.
+    extern thread_local Buffer *current;
+
+    // Starts recording on the calling thread into a new ring of at least
+    // capacity events (16 bytes each). The thread must call stop() before it
+    // exits. A ring that outgrows the caches costs more than the recording
+    // itself on long checks, hence the 1 MB default.
+    void start(std::size_t capacity = 1 << 16);
+    // Stops recording on the calling thread. Its events are kept for export.
+    void stop();
+    // Writes the events of every stopped buffer as Chrome trace-event JSON.
+    void write_chrome_json(std::ostream &out);
+    // Drops all stopped buffers.
+    void clear();
+}
+
+#ifdef SUBTYPE_TRACE
+#define TRACE_ENABLED 1
+#define TRACE(buffer, call) do { if(buffer) { (buffer)->call; } } while(0)
+#else
+#define TRACE_ENABLED 0
+#define TRACE(buffer, call) do {} while(0)
+#endif
+
+#endif // TRACE_HPP
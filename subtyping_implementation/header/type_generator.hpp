@@ -2,6 +2,7 @@
 #define TYPE_GENERATOR_HPP
 
 #include <random>
+#include <cstdint>
 
 #include "graph.hpp"
 #include "type.hpp"
@@ -9,5 +10,8 @@
 Type generate_random_type(int max_size, int branching_factor, std::mt19937 &rng, bool recursive = true, int num_participants=2);
 Type generate_exponential_counterexample(int k);
 Type generate_random_isomorphic_type(int nodes, std::mt19937 &rng);
+// Iterative, multi-threaded generator for 10^6-10^7 node types. The result
+// depends only on the arguments other than threads (0 uses every core).
+Type generate_large_random_type(size_t size, int branching_factor, uint64_t seed, int threads = 0, bool recursive = true, int num_participants = 2);
 
 #endif // TYPE_GENERATOR_HPP
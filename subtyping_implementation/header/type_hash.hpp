@@ -0,0 +1,26 @@
+// Content hash of a type that is the same in every run: it depends only on
+// the part of the type reachable from the root, not on node addresses or on
+// the order of Type::nodes. Nodes are numbered in BFS order from the root,
+// taking edges in label order, and the hash covers each node's kind,
+// participant, payload or labels and the numbers of its continuations, so
+// isomorphic types hash alike.
+
+#ifndef TYPE_HASH_HPP
+#define TYPE_HASH_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+#include "type.hpp"
+
+struct TypeHash {
+    uint64_t lo;
+    uint64_t hi;
+
+    bool operator==(const TypeHash &other) const { return lo == other.lo && hi == other.hi; }
+    bool operator!=(const TypeHash &other) const { return !(*this == other); }
+};
+
+TypeHash canonical_hash(const Type &t);
+
+#endif // TYPE_HASH_HPP
@@ -6,10 +6,10 @@ sns.set_theme(style="darkgrid")
 
 sns.set_context("talk", font_scale=1.8)
 
-worst_case_results = pd.read_csv('results_worst_case.txt')
-iso_results = pd.read_csv('results_isomorphic.txt')
-idemp_results = pd.read_csv('results_idempotent.txt')
-unfolded_results = pd.read_csv('results_unfolded.txt')
+worst_case_results = pd.read_csv('results_worst_case.txt', comment='#')
+iso_results = pd.read_csv('results_isomorphic.txt', comment='#')
+idemp_results = pd.read_csv('results_idempotent.txt', comment='#')
+unfolded_results = pd.read_csv('results_unfolded.txt', comment='#')
 
 def plot(df, title, iters=1):
     algos = df['algorithm'].unique()
@@ -0,0 +1,54 @@
+#include "batch.hpp"
+
+#include <memory>
+#include <algorithm>
+
+std::vector<Verdict> subtype_batch(const std::vector<Query> &queries, bool inductive, int width, const CancelToken *cancel, ResultStore *store) {
+    std::vector<Verdict> verdicts(queries.size(), Verdict::Unknown);
+    std::vector<std::pair<TypeHash, TypeHash>> hashes;
+    if(store) {
+        hashes.reserve(queries.size());
+        for(std::size_t i = 0; i < queries.size(); i++) {
+            hashes.push_back({canonical_hash(*queries[i].first), canonical_hash(*queries[i].second)});
+            verdicts[i] = store->lookup(hashes[i].first, hashes[i].second);
+        }
+    }
+
+    struct Slot {
+        std::size_t query;
+        std::unique_ptr<SuspendedCheck> check;
+    };
+    std::vector<Slot> slots;
+    std::size_t next = 0;
+    auto refill = [&](Slot &slot) {
+        slot.check = nullptr;
+        while(next < queries.size() && verdicts[next] != Verdict::Unknown) next++; // answered by the store
+        if(next == queries.size()) return;
+        slot.query = next++;
+        slot.check = start_check(*queries[slot.query].first, *queries[slot.query].second, inductive);
+    };
+    slots.resize(std::max(1, width));
+    for(Slot &slot : slots) {
+        refill(slot);
+    }
+
+    // Round robin over the slots; a finished check hands its slot to the next
+    // query, and the batch is done once every slot has run dry.
+    std::size_t active = 0;
+    for(Slot &slot : slots) {
+        active += slot.check != nullptr;
+    }
+    while(active > 0) {
+        if(cancel && cancel->load(std::memory_order_relaxed)) break;
+        for(Slot &slot : slots) {
+            if(!slot.check) continue;
+            Verdict verdict = run_to_next_pair(*slot.check);
+            if(verdict == Verdict::Unknown) continue;
+            verdicts[slot.query] = verdict;
+            if(store) store->add(hashes[slot.query].first, hashes[slot.query].second, verdict);
+            refill(slot);
+            active -= slot.check == nullptr;
+        }
+    }
+    return verdicts;
+}
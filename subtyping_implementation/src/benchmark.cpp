@@ -0,0 +1,224 @@
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <system_error>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#ifdef __linux__
+// The recursive engines use a stack frame per pair on the current path, and
+// on the hard families that path grows with the product of the type sizes
+// (n(n+1) pairs for coprime-cycles), far past the default 8 MB. The stack is
+// only reserved, so a large one costs nothing until a check reaches into it.
+static const std::size_t WORKER_STACK = std::size_t(1) << 30;
+
+void* BenchmarkRunner::run_worker(void *runner) {
+    static_cast<BenchmarkRunner*>(runner)->worker_loop();
+    return nullptr;
+}
+#endif
+
+BenchmarkRunner::BenchmarkRunner(int cpu) {
+#ifdef __linux__
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, WORKER_STACK);
+    int error = pthread_create(&worker, &attr, run_worker, this);
+    pthread_attr_destroy(&attr);
+    if(error != 0) {
+        // A 1 GB reservation can be refused (ulimit -v, strict overcommit);
+        // the worker then only takes the sizes the default stack does.
+        error = pthread_create(&worker, nullptr, run_worker, this);
+    }
+    if(error != 0) throw std::system_error(error, std::generic_category(), "cannot start the benchmark worker");
+    if(cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(worker, sizeof(set), &set);
+    }
+#else
+    worker = std::thread([this]() { worker_loop(); });
+    (void) cpu;
+#endif
+}
+
+BenchmarkRunner::~BenchmarkRunner() {
+    {
+        std::lock_guard<std::mutex> lk(m);
+        shutdown = true;
+    }
+    cv.notify_all();
+#ifdef __linux__
+    pthread_join(worker, nullptr);
+#else
+    worker.join();
+#endif
+}
+
+void BenchmarkRunner::worker_loop() {
+    PerfCounters perf; // must be opened on the thread it measures
+    std::unique_lock<std::mutex> lk(m);
+    while(true) {
+        cv.wait(lk, [&]() { return pending != nullptr || shutdown; });
+        if(shutdown) return;
+        const Job *job = pending;
+        SubtypeStats *stats = pending_stats;
+        pending = nullptr;
+        lk.unlock();
+
+        perf.start();
+        auto start_time = std::chrono::steady_clock::now();
+        (*job)(timeout_handler, stats);
+        auto end_time = std::chrono::steady_clock::now();
+        HardwareCounters counters = perf.stop();
+
+        lk.lock();
+        last_counters = counters;
+        last_time = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time).count();
+        done = true;
+        cv.notify_all();
+    }
+}
+
+bool BenchmarkRunner::run_once(const Job &job, long long timeout, SubtypeStats *stats, long long &time_taken) {
+    std::unique_lock<std::mutex> lk(m);
+    timeout_handler.store(false, std::memory_order_relaxed);
+    done = false;
+    pending = &job;
+    pending_stats = stats;
+    cv.notify_all();
+    bool finished = cv.wait_for(lk, std::chrono::nanoseconds(timeout), [&]() { return done; });
+    if(!finished) {
+        // The engines poll the token, so the job winds down promptly.
+        timeout_handler.store(true, std::memory_order_relaxed);
+        cv.wait(lk, [&]() { return done; });
+    }
+    time_taken = last_time;
+    return finished;
+}
+
+Measurement BenchmarkRunner::measure(const Job &job, const BenchmarkConfig &config) {
+    Measurement result;
+    long long time_taken = 0;
+    for(int i = 0; i < config.warmup; i++) {
+        if(!run_once(job, config.timeout, nullptr, time_taken)) {
+            // A failed warm-up is not a trial, so there are no samples.
+            result.success = false;
+            break;
+        }
+    }
+    for(int i = 0; result.success && i < config.trials; i++) {
+        result.success = run_once(job, config.timeout, nullptr, time_taken);
+        result.samples.push_back(time_taken);
+        result.counters = last_counters;
+    }
+#if STATS_ENABLED
+    if(result.success) {
+        // Counting slows the job down, so its time is not a sample.
+        run_once(job, config.timeout, &result.stats, time_taken);
+    }
+#endif
+
+    std::vector<long long> sorted = result.samples;
+    std::sort(sorted.begin(), sorted.end());
+    if(!sorted.empty()) {
+        size_t n = sorted.size();
+        result.min = sorted[0];
+        result.median = sorted[n / 2];
+        result.p99 = sorted[std::min(n - 1, (n * 99 + 99) / 100 - 1)];
+    }
+    return result;
+}
+
+static std::string json_string(const std::string &s) {
+    std::string result = "\"";
+    for(char c : s) {
+        if(c == '"' || c == '\\') result += '\\';
+        result += c;
+    }
+    return result + "\"";
+}
+
+ResultWriter::ResultWriter(std::ostream &out, Format format, const Metadata &metadata) : out(out), format(format) {
+    if(format == CSV) {
+        for(auto &entry : metadata) {
+            out << "# " << entry.first << ": " << entry.second << '\n';
+        }
+        out << "algorithm,k,success,time,min,median,p99,trials,samples,"
+            << "as_in,as_out,as_branch,as_select,as_assump,as_end,"
+            << "sigma_inserts,sigma_erases,peak_sigma,max_depth,label_merge_steps,"
+            << "cycles,cache_misses,branch_misses" << std::endl;
+    } else {
+        out << "{\n  \"metadata\": {";
+        for(size_t i = 0; i < metadata.size(); i++) {
+            out << (i == 0 ? "\n" : ",\n") << "    " << json_string(metadata[i].first) << ": " << json_string(metadata[i].second);
+        }
+        out << "\n  },\n  \"results\": [";
+    }
+}
+
+ResultWriter::~ResultWriter() {
+    if(format == JSON) {
+        out << "\n  ]\n}" << std::endl;
+    }
+}
+
+// Counter values in CSV column order; empty when not collected.
+static std::vector<std::pair<const char*, std::string>> counter_fields(const Measurement &measurement) {
+    const SubtypeStats &s = measurement.stats;
+    const HardwareCounters &c = measurement.counters;
+    auto stat = [&](unsigned long long v) { return STATS_ENABLED ? std::to_string(v) : std::string(); };
+    auto hw = [&](long long v) { return c.available ? std::to_string(v) : std::string(); };
+    return {
+        {"as_in", stat(s.rules[SubtypeStats::AS_In])},
+        {"as_out", stat(s.rules[SubtypeStats::AS_Out])},
+        {"as_branch", stat(s.rules[SubtypeStats::AS_Branch])},
+        {"as_select", stat(s.rules[SubtypeStats::AS_Select])},
+        {"as_assump", stat(s.rules[SubtypeStats::AS_Assump])},
+        {"as_end", stat(s.rules[SubtypeStats::AS_End])},
+        {"sigma_inserts", stat(s.sigma_inserts)},
+        {"sigma_erases", stat(s.sigma_erases)},
+        {"peak_sigma", stat(s.peak_sigma)},
+        {"max_depth", stat(s.max_depth)},
+        {"label_merge_steps", stat(s.label_merge_steps)},
+        {"cycles", hw(c.cycles)},
+        {"cache_misses", hw(c.cache_misses)},
+        {"branch_misses", hw(c.branch_misses)},
+    };
+}
+
+void ResultWriter::write(const std::string &algorithm, long long k, const Measurement &measurement) {
+    auto counters = counter_fields(measurement);
+    if(format == CSV) {
+        out << algorithm << ',' << k << ',' << measurement.success << ',' << measurement.median << ','
+            << measurement.min << ',' << measurement.median << ',' << measurement.p99 << ','
+            << measurement.samples.size() << ',';
+        for(size_t i = 0; i < measurement.samples.size(); i++) {
+            out << (i == 0 ? "" : ";") << measurement.samples[i];
+        }
+        for(auto &field : counters) {
+            out << ',' << field.second;
+        }
+        out << std::endl;
+    } else {
+        out << (first_row ? "\n" : ",\n");
+        out << "    {\"algorithm\": " << json_string(algorithm) << ", \"k\": " << k
+            << ", \"success\": " << (measurement.success ? "true" : "false") << ", \"time\": " << measurement.median
+            << ", \"min\": " << measurement.min << ", \"median\": " << measurement.median
+            << ", \"p99\": " << measurement.p99 << ", \"trials\": " << measurement.samples.size() << ", \"samples\": [";
+        for(size_t i = 0; i < measurement.samples.size(); i++) {
+            out << (i == 0 ? "" : ", ") << measurement.samples[i];
+        }
+        out << "]";
+        for(auto &field : counters) {
+            out << ", \"" << field.first << "\": " << (field.second.empty() ? "null" : field.second);
+        }
+        out << "}";
+        out.flush();
+    }
+    first_row = false;
+}
@@ -0,0 +1,86 @@
+#include "compact.hpp"
+#include "graph.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+using namespace graph;
+
+// Calls f on a reference to every outgoing edge of node, in label order.
+template <typename F>
+void for_each_edge(GraphNode *node, F f) {
+    switch(node->type()) {
+        case TypeIn:
+            f(static_cast<In*>(node)->continuation);
+            break;
+        case TypeOut:
+            f(static_cast<Out*>(node)->continuation);
+            break;
+        case TypeBranch:
+            for(auto &branch : static_cast<Branch*>(node)->branches) f(branch.second);
+            break;
+        case TypeSelect:
+            for(auto &branch : static_cast<Select*>(node)->branches) f(branch.second);
+            break;
+        case TypeEnd:
+            break;
+    }
+}
+
+// A copy of node without its branches, so that copying allocates only the
+// node itself.
+static GraphNode* copy_without_branches(GraphNode *node) {
+    switch(node->type()) {
+        case TypeBranch:
+            return new Branch(static_cast<Branch*>(node)->participant);
+        case TypeSelect:
+            return new Select(static_cast<Select*>(node)->participant);
+        default:
+            return node->copy();
+    }
+}
+
+CompactionReport compact(Type &t) {
+    CompactionReport report = {t.nodes.size(), 0};
+    if(t.root == nullptr) return report;
+
+    // Iterative DFS preorder; successors are pushed in reverse so that the
+    // first one comes right after its parent.
+    std::unordered_map<GraphNode*, std::size_t> index;
+    std::vector<GraphNode*> order, stack = {t.root}, successors;
+    index.reserve(t.nodes.size());
+    while(!stack.empty()) {
+        GraphNode *node = stack.back();
+        stack.pop_back();
+        if(!index.emplace(node, order.size()).second) continue;
+        order.push_back(node);
+        successors.clear();
+        for_each_edge(node, [&](GraphNode *next) { successors.push_back(next); });
+        for(auto it = successors.rbegin(); it != successors.rend(); ++it) {
+            if(!index.count(*it)) stack.push_back(*it);
+        }
+    }
+
+    // The nodes are copied back to back, with no other allocations in
+    // between, so that they end up next to each other; the branch vectors of
+    // choices are only filled in afterwards.
+    std::vector<GraphNode*> nodes(order.size());
+    for(std::size_t i = 0; i < order.size(); i++) {
+        nodes[i] = copy_without_branches(order[i]);
+    }
+    for(std::size_t i = 0; i < order.size(); i++) {
+        if(order[i]->type() == TypeBranch) {
+            static_cast<Branch*>(nodes[i])->branches = static_cast<Branch*>(order[i])->branches;
+        } else if(order[i]->type() == TypeSelect) {
+            static_cast<Select*>(nodes[i])->branches = static_cast<Select*>(order[i])->branches;
+        }
+        for_each_edge(nodes[i], [&](GraphNode *&next) { next = nodes[index[next]]; });
+    }
+    for(GraphNode *node : t.nodes) {
+        delete node;
+    }
+    t.root = nodes[0];
+    t.nodes = nodes;
+    report.nodes_after = nodes.size();
+    return report;
+}
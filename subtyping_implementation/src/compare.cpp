@@ -0,0 +1,158 @@
+#include "compare.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+struct ResultFile {
+    std::map<std::string, std::string> metadata;
+    std::map<std::pair<std::string, long long>, std::pair<bool, std::vector<long long>>> rows;
+};
+
+static std::vector<std::string> split(const std::string &s, char separator) {
+    std::vector<std::string> fields;
+    std::stringstream stream(s);
+    std::string field;
+    while(std::getline(stream, field, separator)) {
+        fields.push_back(field);
+    }
+    if(!s.empty() && s.back() == separator) fields.push_back("");
+    return fields;
+}
+
+// Parses the whole of field as a number; false on anything else.
+static bool parse_number(const std::string &field, long long &value) {
+    try {
+        size_t end;
+        value = std::stoll(field, &end);
+        return end == field.size();
+    } catch(const std::logic_error&) {
+        return false;
+    }
+}
+
+// Reads a CSV result file; on failure, sets error to why.
+static bool read_result_file(const std::string &path, ResultFile &result, std::string &error) {
+    std::ifstream in(path);
+    if(!in) {
+        error = "cannot be read";
+        return false;
+    }
+    std::string line;
+    std::map<std::string, size_t> columns;
+    long long line_number = 0;
+    while(std::getline(in, line)) {
+        line_number++;
+        if(line.empty()) continue;
+        if(columns.empty() && line[0] == '{') {
+            error = "is JSON; only CSV results (written without --json) can be compared";
+            return false;
+        }
+        if(line[0] == '#') {
+            size_t colon = line.find(':');
+            if(colon != std::string::npos && colon + 2 <= line.size()) {
+                result.metadata[line.substr(2, colon - 2)] = line.substr(colon + 2);
+            }
+            continue;
+        }
+        std::vector<std::string> fields = split(line, ',');
+        if(columns.empty()) {
+            for(size_t i = 0; i < fields.size(); i++) {
+                columns[fields[i]] = i;
+            }
+            for(const char *column : {"algorithm", "k", "success", "samples"}) {
+                if(!columns.count(column)) {
+                    error = std::string("has no ") + column + " column";
+                    return false;
+                }
+            }
+            continue;
+        }
+        long long k, sample;
+        std::vector<long long> samples;
+        bool valid = fields.size() == columns.size() && parse_number(fields[columns.at("k")], k);
+        for(const std::string &field : valid ? split(fields[columns.at("samples")], ';') : std::vector<std::string>()) {
+            valid = valid && parse_number(field, sample);
+            samples.push_back(sample);
+        }
+        if(!valid) {
+            error = "has a malformed row at line " + std::to_string(line_number);
+            return false;
+        }
+        result.rows[{fields[columns.at("algorithm")], k}] = {fields[columns.at("success")] == "1", samples};
+    }
+    if(columns.empty()) {
+        error = "has no header";
+        return false;
+    }
+    return true;
+}
+
+// One-sided Mann-Whitney U test that current is stochastically larger than
+// baseline, using the normal approximation with continuity correction.
+static double mann_whitney_p(const std::vector<long long> &baseline, const std::vector<long long> &current) {
+    double n1 = baseline.size(), n2 = current.size();
+    double u = 0;
+    for(long long c : current) {
+        for(long long b : baseline) {
+            u += c > b ? 1.0 : (c == b ? 0.5 : 0.0);
+        }
+    }
+    double mean = n1 * n2 / 2;
+    double sd = std::sqrt(n1 * n2 * (n1 + n2 + 1) / 12);
+    double z = (u - mean - 0.5) / sd;
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+static long long median(std::vector<long long> samples) {
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+int compare_results(const std::string &baseline_path, const std::string &current_path, const CompareOptions &options, std::ostream &out) {
+    ResultFile baseline, current;
+    std::string error;
+    if(!read_result_file(baseline_path, baseline, error)) {
+        out << "malformed baseline: " << baseline_path << " " << error << std::endl;
+        return -1;
+    }
+    if(!read_result_file(current_path, current, error)) {
+        out << "malformed current run: " << current_path << " " << error << std::endl;
+        return -1;
+    }
+    for(const char *key : {"suite", "build_flags", "cpu", "iterations", "type_size"}) {
+        if(baseline.metadata[key] != current.metadata[key]) {
+            out << "# warning: " << key << " differs (" << baseline.metadata[key] << " vs " << current.metadata[key] << ")" << std::endl;
+        }
+    }
+
+    int regressions = 0;
+    out << "algorithm,k,baseline_median,current_median,ratio,p_value,verdict" << std::endl;
+    for(auto &row : current.rows) {
+        auto base = baseline.rows.find(row.first);
+        if(base == baseline.rows.end()) continue;
+        bool base_success = base->second.first, current_success = row.second.first;
+        const std::vector<long long> &b = base->second.second, &c = row.second.second;
+        if(b.empty() || c.empty()) continue;
+
+        std::string verdict = "ok";
+        double p = 1.0;
+        double ratio = static_cast<double>(median(c)) / std::max(1LL, median(b));
+        if(base_success && !current_success) {
+            verdict = "timeout";
+        } else if(base_success && current_success) {
+            p = mann_whitney_p(b, c);
+            if(p < options.alpha && ratio > 1 + options.threshold) verdict = "slower";
+            else if(mann_whitney_p(c, b) < options.alpha && ratio < 1 - options.threshold) verdict = "faster";
+        }
+        if(verdict == "slower" || verdict == "timeout") regressions++;
+        out << row.first.first << ',' << row.first.second << ',' << median(b) << ',' << median(c) << ','
+            << ratio << ',' << p << ',' << verdict << std::endl;
+    }
+    out << "# " << regressions << " regression(s)" << std::endl;
+    return regressions;
+}
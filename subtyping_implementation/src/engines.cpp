@@ -0,0 +1,174 @@
+#include "engines.hpp"
+#include "subtyping.hpp"
+#include "resumable.hpp"
+#include "strategy.hpp"
+#include "matcher.hpp"
+#include "lazy.hpp"
+#include "many.hpp"
+#include "ast.hpp"
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+
+// Runs a step-budgeted check in slices, polling the token in between.
+template <BudgetedResult (*check)(Type&, Type&, unsigned long long)>
+bool sliced(Type &t1, Type &t2, const CancelToken &timeout_handler, SubtypeStats*) {
+    const unsigned long long SLICE = 4096;
+    BudgetedResult result = check(t1, t2, SLICE);
+    while(result.verdict == Verdict::Unknown) {
+        if(timeout_handler.load(std::memory_order_relaxed)) return false;
+        result = resume(std::move(result.suspended), SLICE);
+    }
+    return result.verdict == Verdict::Yes;
+}
+
+template <Strategy strategy>
+bool explored(Type &t1, Type &t2, const CancelToken &timeout_handler, SubtypeStats *stats) {
+    return coinductive_sub::subtype(t1, t2, strategy, timeout_handler, stats);
+}
+
+// Compiles t2 for every check, so only useful to cross-check the matcher.
+bool compiled(Type &t1, Type &t2, const CancelToken &timeout_handler, SubtypeStats*) {
+    CompiledContract contract(t2);
+    return contract.subtype(t1, timeout_handler);
+}
+
+// AST of the part of a type reachable from its root. Every node becomes
+// mu X.body with a variable of its own, and an edge back to a node on the
+// current path becomes that node's variable. A subtree built before is
+// shared when every variable it uses is bound on the current path, and is
+// built again otherwise.
+class AstOfType {
+    public:
+    explicit AstOfType(const Type &t) {
+        std::vector<ast::TVar> free;
+        root = build(t.root, free);
+    }
+
+    ast::ASTNode *root;
+
+    private:
+    struct Built {
+        ast::ASTNode *ast;
+        std::vector<ast::TVar> free; // variables of nodes above it
+    };
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        auto node = std::make_shared<T>(std::forward<Args>(args)...);
+        pool.push_back(node);
+        return node.get();
+    }
+
+    ast::TVar var(graph::GraphNode *node) {
+        return vars.emplace(node, static_cast<ast::TVar>(vars.size())).first->second;
+    }
+
+    void merge(std::vector<ast::TVar> &free, const std::vector<ast::TVar> &more) {
+        for(ast::TVar v : more) {
+            if(std::find(free.begin(), free.end(), v) == free.end()) free.push_back(v);
+        }
+    }
+
+    // Adds the variables the subtree uses from above it to free.
+    ast::ASTNode* build(graph::GraphNode *node, std::vector<ast::TVar> &free) {
+        if(node->type() == graph::TypeEnd) return make<ast::End>();
+        ast::TVar x = var(node);
+        if(path.count(x)) {
+            merge(free, {x});
+            return make<ast::Var>(x);
+        }
+        auto it = built.find(node);
+        if(it != built.end() && std::all_of(it->second.free.begin(), it->second.free.end(), [&](ast::TVar v) { return path.count(v) > 0; })) {
+            merge(free, it->second.free);
+            return it->second.ast;
+        }
+
+        path.insert(x);
+        std::vector<ast::TVar> inner;
+        ast::ASTNode *body = nullptr;
+        switch(node->type()) {
+            case graph::TypeIn: {
+                auto in = static_cast<graph::In*>(node);
+                body = make<ast::In>(in->participant, in->payload, build(in->continuation, inner));
+                break;
+            }
+            case graph::TypeOut: {
+                auto out = static_cast<graph::Out*>(node);
+                body = make<ast::Out>(out->participant, out->payload, build(out->continuation, inner));
+                break;
+            }
+            case graph::TypeBranch:
+            case graph::TypeSelect: {
+                bool is_branch = node->type() == graph::TypeBranch;
+                auto &branches = is_branch ? static_cast<graph::Branch*>(node)->branches : static_cast<graph::Select*>(node)->branches;
+                Participant participant = is_branch ? static_cast<graph::Branch*>(node)->participant : static_cast<graph::Select*>(node)->participant;
+                std::vector<std::pair<ast::Label, ast::ASTNode*>> children;
+                for(auto &branch : branches) {
+                    children.push_back({branch.first, build(branch.second, inner)});
+                }
+                if(is_branch) body = make<ast::Branch>(participant, children);
+                else body = make<ast::Select>(participant, children);
+                break;
+            }
+            case graph::TypeEnd:
+                break;
+        }
+        path.erase(x);
+
+        inner.erase(std::remove(inner.begin(), inner.end(), x), inner.end());
+        merge(free, inner);
+        ast::ASTNode *mu = make<ast::Mu>(x, body);
+        built[node] = {mu, inner};
+        return mu;
+    }
+
+    std::vector<std::shared_ptr<void>> pool;
+    std::unordered_map<graph::GraphNode*, ast::TVar> vars;
+    std::unordered_set<ast::TVar> path;
+    std::unordered_map<graph::GraphNode*, Built> built;
+};
+
+// Rebuilds both types as ASTs and checks them lowered lazily, so only useful
+// to cross-check LazyType against the eager engines.
+bool lazy(Type &t1, Type &t2, const CancelToken &timeout_handler, SubtypeStats *stats) {
+    AstOfType ast1(t1), ast2(t2);
+    LazyType lazy1(ast1.root), lazy2(ast2.root);
+    return coinductive_sub::subtype(lazy1, lazy2, timeout_handler, stats);
+}
+
+// Checks t1 against t2 and against itself in one subtype_many call, so that
+// the merge sees two types and refutes one supertype while the other stays
+// alive; only useful to cross-check subtype_many, which tools/many.cpp
+// benchmarks. A wrong verdict for t1 <= t1 shows up as a disagreement
+// wherever t1 <= t2 holds.
+bool many(Type &t1, Type &t2, const CancelToken &timeout_handler, SubtypeStats*) {
+    std::vector<Verdict> verdicts = subtype_many(t1, {&t2, &t1}, &timeout_handler);
+    return verdicts[0] == Verdict::Yes && verdicts[1] == Verdict::Yes;
+}
+
+const std::vector<Engine>& engines() {
+    static const std::vector<Engine> all = {
+        {"inductive", inductive_sub::subtype, true},
+        {"coinductive", coinductive_sub::subtype, true},
+        {"inductive-stepped", sliced<inductive_sub::subtype>},
+        {"coinductive-stepped", sliced<coinductive_sub::subtype>},
+        {"coinductive-label-order", explored<Strategy::LabelOrder>},
+        {"coinductive-bfs", explored<Strategy::BreadthFirst>},
+        {"coinductive-shallowest", explored<Strategy::ShallowestFirst>},
+        {"coinductive-cheapest", explored<Strategy::CheapestFirst>},
+        {"coinductive-compiled", compiled, false, true},
+        {"coinductive-lazy", lazy, true, true},
+        {"coinductive-many", many, false, true},
+    };
+    return all;
+}
+
+const Engine* find_engine(const std::string &name) {
+    for(const Engine &engine : engines()) {
+        if(engine.name == name) return &engine;
+    }
+    return nullptr;
+}
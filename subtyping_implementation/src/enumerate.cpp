@@ -0,0 +1,181 @@
+#include "enumerate.hpp"
+
+#include <array>
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+// Workers share the search tree by taking turns over the subtrees that start
+// at this node: each one walks the tree above it and only descends into every
+// workers-th subtree. Smaller types are produced by worker 0.
+static const int SPLIT_NODE = 2;
+
+namespace {
+    struct Slot {
+        graph::NodeType kind;
+        Participant participant;
+        Sort payload;
+        unsigned labels; // bit l set when label l is offered
+        int edges;
+        std::array<int, MAX_ENUMERATED_LABELS> targets;
+    };
+
+    class Enumerator {
+        public:
+        Enumerator(const EnumerationBounds &bounds, unsigned worker, unsigned workers,
+                   const std::function<void(Type&, unsigned)> &visit)
+            : bounds(bounds), worker(worker), workers(workers), visit(visit), slots(bounds.nodes) {}
+
+        unsigned long long run() {
+            discovered = 1;
+            node(0);
+            return count;
+        }
+
+        private:
+        // Chooses the contents of slot i, all slots before it being decided.
+        void node(int i) {
+            if(i == SPLIT_NODE && subtree++ % workers != worker) return;
+            if(i == discovered) {
+                if(i >= SPLIT_NODE || worker == 0) emit();
+                return;
+            }
+            Slot &slot = slots[i];
+            slot.kind = graph::TypeEnd;
+            slot.edges = 0;
+            node(i + 1);
+
+            int used = participants_used;
+            int limit = bounds.participant_symmetry ? std::min(used + 1, bounds.participants) : bounds.participants;
+            for(Participant p = 0; p < limit; p++) {
+                slot.participant = p;
+                participants_used = std::max(used, p + 1);
+                for(graph::NodeType kind : {graph::TypeIn, graph::TypeOut}) {
+                    slot.kind = kind;
+                    slot.edges = 1;
+                    for(Sort payload : {Int, Nat, Bool}) {
+                        slot.payload = payload;
+                        edge(i, 0);
+                    }
+                }
+                for(graph::NodeType kind : {graph::TypeBranch, graph::TypeSelect}) {
+                    slot.kind = kind;
+                    for(unsigned labels = 1; labels < (1u << bounds.labels); labels++) {
+                        slot.labels = labels;
+                        slot.edges = __builtin_popcount(labels);
+                        edge(i, 0);
+                    }
+                }
+            }
+            participants_used = used;
+        }
+
+        // Chooses the target of edge j of slot i: a numbered node, or the
+        // next number if there is room.
+        void edge(int i, int j) {
+            Slot &slot = slots[i];
+            if(j == slot.edges) {
+                node(i + 1);
+                return;
+            }
+            for(int target = 0; target < discovered; target++) {
+                slot.targets[j] = target;
+                edge(i, j + 1);
+            }
+            if(discovered < bounds.nodes) {
+                slot.targets[j] = discovered++;
+                edge(i, j + 1);
+                discovered--;
+            }
+        }
+
+        void emit() {
+            Type t;
+            t.nodes.reserve(discovered);
+            for(int i = 0; i < discovered; i++) {
+                const Slot &slot = slots[i];
+                switch(slot.kind) {
+                    case graph::TypeIn: {
+                        graph::In *in = new graph::In(slot.participant);
+                        in->payload = slot.payload;
+                        t.nodes.push_back(in);
+                        break;
+                    }
+                    case graph::TypeOut: {
+                        graph::Out *out = new graph::Out(slot.participant);
+                        out->payload = slot.payload;
+                        t.nodes.push_back(out);
+                        break;
+                    }
+                    case graph::TypeBranch:
+                        t.nodes.push_back(new graph::Branch(slot.participant));
+                        break;
+                    case graph::TypeSelect:
+                        t.nodes.push_back(new graph::Select(slot.participant));
+                        break;
+                    case graph::TypeEnd:
+                        t.nodes.push_back(new graph::End());
+                        break;
+                }
+            }
+            for(int i = 0; i < discovered; i++) {
+                const Slot &slot = slots[i];
+                graph::GraphNode *node = t.nodes[i];
+                switch(slot.kind) {
+                    case graph::TypeIn:
+                        static_cast<graph::In*>(node)->continuation = t.nodes[slot.targets[0]];
+                        break;
+                    case graph::TypeOut:
+                        static_cast<graph::Out*>(node)->continuation = t.nodes[slot.targets[0]];
+                        break;
+                    case graph::TypeBranch:
+                    case graph::TypeSelect: {
+                        auto &branches = slot.kind == graph::TypeBranch ? static_cast<graph::Branch*>(node)->branches
+                                                                         : static_cast<graph::Select*>(node)->branches;
+                        branches.reserve(slot.edges);
+                        int j = 0;
+                        for(graph::Label l = 0; l < bounds.labels; l++) {
+                            if(slot.labels & (1u << l)) branches.push_back({l, t.nodes[slot.targets[j++]]});
+                        }
+                        break;
+                    }
+                    case graph::TypeEnd:
+                        break;
+                }
+            }
+            t.root = t.nodes[0];
+            visit(t, worker);
+            count++;
+        }
+
+        const EnumerationBounds &bounds;
+        unsigned worker, workers;
+        const std::function<void(Type&, unsigned)> &visit;
+        std::vector<Slot> slots;
+        int discovered = 0;
+        int participants_used = 0;
+        unsigned long long subtree = 0;
+        unsigned long long count = 0;
+    };
+}
+
+unsigned long long enumerate_types(const EnumerationBounds &bounds, const std::function<void(Type &t, unsigned worker)> &visit, unsigned threads) {
+    if(bounds.nodes < 1 || bounds.labels < 1 || bounds.labels > MAX_ENUMERATED_LABELS || bounds.participants < 1) return 0;
+    if(threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    if(bounds.nodes <= SPLIT_NODE) threads = 1;
+
+    std::vector<unsigned long long> counts(threads, 0);
+    std::vector<std::thread> pool;
+    for(unsigned w = 1; w < threads; w++) {
+        pool.emplace_back([&, w]() { counts[w] = Enumerator(bounds, w, threads, visit).run(); });
+    }
+    counts[0] = Enumerator(bounds, 0, threads, visit).run();
+    for(std::thread &t : pool) {
+        t.join();
+    }
+    unsigned long long total = 0;
+    for(unsigned long long c : counts) {
+        total += c;
+    }
+    return total;
+}
@@ -0,0 +1,208 @@
+#include "hard_instances.hpp"
+#include "type_generator.hpp"
+#include "graph.hpp"
+#include "sort.hpp"
+
+#include <algorithm>
+
+using namespace graph;
+
+template <typename T>
+T* add_node(Type &t, T *node) {
+    t.nodes.push_back(node);
+    return node;
+}
+
+// Branch nodes b_0..b_{n-1} with l0: b_{i+1 mod n} and l1: b_{i/2}, i.e. a
+// main cycle with nested cycles back to every ancestor level. Equivalent to
+// μX.&{l0: X, l1: X} for every n.
+void build_nested_cycles(Type &t, int n) {
+    std::vector<Branch*> nodes;
+    for(int i = 0; i < n; i++) {
+        nodes.push_back(add_node(t, new Branch(0)));
+    }
+    for(int i = 0; i < n; i++) {
+        nodes[i]->branches.push_back({0, nodes[(i + 1) % n]});
+        nodes[i]->branches.push_back({1, nodes[i / 2]});
+    }
+    t.root = nodes[0];
+}
+
+HardInstance nested_cycles(int n) {
+    HardInstance instance;
+    build_nested_cycles(instance.sub, std::max(1, n));
+    build_nested_cycles(instance.super, std::max(1, n) + 1);
+    instance.expected = true;
+    return instance;
+}
+
+// μX.p0![Int];...;p0![Int];X with length sends.
+void build_send_cycle(Type &t, int length) {
+    std::vector<Out*> nodes;
+    for(int i = 0; i < length; i++) {
+        Out* out = add_node(t, new Out(0));
+        out->payload = Int;
+        nodes.push_back(out);
+    }
+    for(int i = 0; i < length; i++) {
+        nodes[i]->continuation = nodes[(i + 1) % length];
+    }
+    t.root = nodes[0];
+}
+
+HardInstance coprime_cycles(int n) {
+    // Cycles of length n and n+1 are coprime, so the product has n(n+1) states.
+    HardInstance instance;
+    build_send_cycle(instance.sub, std::max(1, n));
+    build_send_cycle(instance.super, std::max(1, n) + 1);
+    instance.expected = true;
+    return instance;
+}
+
+// p0⊕{l_0, ..., l_{n-1}} with every label leading to a chain of n receives
+// and then to a chain of n sends back to the root. With shared_sink the send
+// chain exists once; otherwise every label gets its own copy.
+void build_wide_choice(Type &t, int n, bool shared_sink) {
+    Select* root = add_node(t, new Select(0));
+    t.root = root;
+    auto build_sink = [&]() {
+        std::vector<Out*> chain;
+        for(int i = 0; i < n; i++) {
+            Out* out = add_node(t, new Out(0));
+            out->payload = Nat;
+            chain.push_back(out);
+        }
+        for(int i = 0; i < n; i++) {
+            chain[i]->continuation = i + 1 < n ? static_cast<GraphNode*>(chain[i + 1]) : root;
+        }
+        return chain[0];
+    };
+    GraphNode *sink = shared_sink ? build_sink() : nullptr;
+    for(int label = 0; label < n; label++) {
+        GraphNode *next = shared_sink ? sink : build_sink();
+        for(int i = 0; i < n; i++) {
+            In* in = add_node(t, new In(1));
+            in->payload = Int;
+            in->continuation = next;
+            next = in;
+        }
+        root->branches.push_back({label, next});
+    }
+}
+
+HardInstance wide_choice(int n) {
+    HardInstance instance;
+    build_wide_choice(instance.sub, std::max(1, n), true);
+    build_wide_choice(instance.super, std::max(1, n), false);
+    instance.expected = true;
+    return instance;
+}
+
+// For each of n participants: p?[.]; p![.]; p&{...}; p⊕{...}, repeated rounds
+// times and looping. The sub side receives Int, sends Nat, offers fewer
+// branches and more selections than the super side, so every rule needs its
+// variance to hold.
+void build_mixed(Type &t, int n, int rounds, bool sub) {
+    std::vector<GraphNode*> sequence;
+    for(int round = 0; round < rounds; round++) {
+        for(int p = 0; p < n; p++) {
+            In* in = add_node(t, new In(p));
+            in->payload = sub ? Int : Nat;
+            Out* out = add_node(t, new Out(p));
+            out->payload = sub ? Nat : Int;
+            sequence.push_back(in);
+            sequence.push_back(out);
+            sequence.push_back(add_node(t, new Branch(p)));
+            sequence.push_back(add_node(t, new Select(p)));
+        }
+    }
+    End* end = add_node(t, new End());
+    for(size_t i = 0; i < sequence.size(); i++) {
+        GraphNode *next = sequence[(i + 1) % sequence.size()];
+        switch(sequence[i]->type()) {
+            case TypeIn:
+                static_cast<In*>(sequence[i])->continuation = next;
+                break;
+            case TypeOut:
+                static_cast<Out*>(sequence[i])->continuation = next;
+                break;
+            case TypeBranch: {
+                auto &branches = static_cast<Branch*>(sequence[i])->branches;
+                branches.push_back({0, next});
+                if(!sub) branches.push_back({1, end});
+                break;
+            }
+            case TypeSelect: {
+                auto &branches = static_cast<Select*>(sequence[i])->branches;
+                branches.push_back({0, next});
+                if(sub) branches.push_back({1, end});
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    t.root = sequence[0];
+}
+
+HardInstance mixed_participants(int n) {
+    HardInstance instance;
+    build_mixed(instance.sub, std::max(1, n), 1, true);
+    build_mixed(instance.super, std::max(1, n), 2, false);
+    instance.expected = true;
+    return instance;
+}
+
+// A chain of n branches, each with l0 back to the root and l1 onwards, ending
+// in p0![payload]; end. The two sides differ only in that last payload.
+void build_near_miss(Type &t, int n, Sort payload) {
+    std::vector<Branch*> chain;
+    for(int i = 0; i < n; i++) {
+        chain.push_back(add_node(t, new Branch(0)));
+    }
+    Out* deepest = add_node(t, new Out(0));
+    deepest->payload = payload;
+    deepest->continuation = add_node(t, new End());
+    for(int i = 0; i < n; i++) {
+        chain[i]->branches.push_back({0, chain[0]});
+        chain[i]->branches.push_back({1, i + 1 < n ? static_cast<GraphNode*>(chain[i + 1]) : deepest});
+    }
+    t.root = chain[0];
+}
+
+HardInstance near_miss(int n) {
+    HardInstance instance;
+    build_near_miss(instance.sub, std::max(1, n), Int);
+    build_near_miss(instance.super, std::max(1, n), Nat);
+    instance.expected = false; // Int is not a subsort of Nat
+    return instance;
+}
+
+HardInstance exponential(int n) {
+    HardInstance instance;
+    instance.sub = generate_exponential_counterexample(std::max(1, n));
+    instance.super = generate_exponential_counterexample(std::max(1, n) + 1);
+    instance.expected = true;
+    return instance;
+}
+
+const std::vector<HardFamily>& hard_families() {
+    static const std::vector<HardFamily> families = {
+        {"nested-cycles", "branch loops with n nested back edges, n vs n+1 levels", nested_cycles, 64},
+        // The recursive engines go n(n+1) pairs deep, at up to 350 bytes of
+        // stack a level in a debug build.
+        {"coprime-cycles", "send cycles of coprime lengths n and n+1", coprime_cycles, 100, 1000},
+        {"wide-choice", "n-way selection into n-deep chains, shared vs copied sinks", wide_choice, 64},
+        {"mixed-participants", "In/Out/Branch/Select over n participants, one round vs two", mixed_participants, 32},
+        {"near-miss", "n-deep branch chains differing only in the deepest payload", near_miss, 256},
+        {"exponential", "exponential counterexample, k vs k+1", exponential, 10},
+    };
+    return families;
+}
+
+const HardFamily* find_hard_family(const std::string &name) {
+    for(const HardFamily &family : hard_families()) {
+        if(family.name == name) return &family;
+    }
+    return nullptr;
+}
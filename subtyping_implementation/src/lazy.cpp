@@ -0,0 +1,104 @@
+#include "lazy.hpp"
+
+#include "assert.h"
+
+LazyType::LazyType(ast::ASTNode *ast) {
+    t.root = materialize(ast, nullptr);
+}
+
+void LazyType::expand_all() {
+    for(std::size_t i = 0; i < t.nodes.size(); i++) {
+        expand(t.nodes[i]);
+    }
+}
+
+// Graph node of ast_node, created unexpanded.
+graph::GraphNode* LazyType::materialize(ast::ASTNode *ast_node, const Frame *env) {
+    ast::ASTNode *body = ast_node;
+    while(body->type() == ast::TypeMu) {
+        body = static_cast<ast::Mu*>(body)->body;
+    }
+    if(body->type() == ast::TypeVar) {
+        assert(body == ast_node); // unguarded recursion
+        ast::TVar var = static_cast<ast::Var*>(body)->var;
+        for(const Frame *frame = env; frame != nullptr; frame = frame->parent) {
+            if(frame->var == var) return frame->node;
+        }
+        assert(false); // unbound variable
+        return nullptr;
+    }
+
+    Source origin = {body, env};
+    graph::GraphNode *node = nullptr;
+    switch(body->type()) {
+        case ast::TypeEnd:
+            node = new graph::End();
+            break;
+        case ast::TypeIn: {
+            ast::In *in = static_cast<ast::In*>(body);
+            auto in_node = new Lowered<graph::In>(in->participant, origin);
+            in_node->payload = in->payload;
+            in_node->continuation = nullptr;
+            node = in_node;
+            break;
+        }
+        case ast::TypeOut: {
+            ast::Out *out = static_cast<ast::Out*>(body);
+            auto out_node = new Lowered<graph::Out>(out->participant, origin);
+            out_node->payload = out->payload;
+            out_node->continuation = nullptr;
+            node = out_node;
+            break;
+        }
+        case ast::TypeBranch:
+            node = new Lowered<graph::Branch>(static_cast<ast::Branch*>(body)->participant, origin);
+            break;
+        case ast::TypeSelect:
+            node = new Lowered<graph::Select>(static_cast<ast::Select*>(body)->participant, origin);
+            break;
+        default:
+            assert(false);
+    }
+    t.nodes.push_back(node);
+    // Binders directly above body are bound to its node, which is in their scope.
+    if(ast_node != body && node->type() != graph::TypeEnd) {
+        for(ast::ASTNode *mu = ast_node; mu != body; mu = static_cast<ast::Mu*>(mu)->body) {
+            frames.push_back({static_cast<ast::Mu*>(mu)->var, node, env});
+            env = &frames.back();
+        }
+        source(node)->env = env;
+    }
+    return node;
+}
+
+void LazyType::expand(graph::GraphNode *node, Source &source) {
+    ast::ASTNode *ast_node = source.ast;
+    const Frame *env = source.env;
+    source.ast = nullptr;
+    switch(node->type()) {
+        case graph::TypeIn:
+            static_cast<graph::In*>(node)->continuation = materialize(static_cast<ast::In*>(ast_node)->continuation, env);
+            break;
+        case graph::TypeOut:
+            static_cast<graph::Out*>(node)->continuation = materialize(static_cast<ast::Out*>(ast_node)->continuation, env);
+            break;
+        case graph::TypeBranch: {
+            auto &branches = static_cast<graph::Branch*>(node)->branches;
+            branches.reserve(static_cast<ast::Branch*>(ast_node)->branches.size());
+            for(auto &branch : static_cast<ast::Branch*>(ast_node)->branches) {
+                branches.push_back({branch.first, materialize(branch.second, env)});
+            }
+            break;
+        }
+        case graph::TypeSelect: {
+            auto &branches = static_cast<graph::Select*>(node)->branches;
+            branches.reserve(static_cast<ast::Select*>(ast_node)->branches.size());
+            for(auto &branch : static_cast<ast::Select*>(ast_node)->branches) {
+                branches.push_back({branch.first, materialize(branch.second, env)});
+            }
+            break;
+        }
+        case graph::TypeEnd:
+            break;
+    }
+}
@@ -1,10 +1,13 @@
 #include <stdio.h>
 #include <iostream>
+#include <fstream>
 #include <random>
 #include <locale>
 #include <string>
+#include <cstring>
 #include <codecvt>
 #include <functional>
+#include <vector>
 
 #include "graph.hpp"
 #include "type.hpp"
@@ -13,124 +16,149 @@
 #include "unfold.hpp"
 #include "ast.hpp"
 #include "parse.hpp"
+#include "benchmark.hpp"
+#include "suite.hpp"
+#include "compare.hpp"
+#include "server.hpp"
 
-// Timer
-#include <chrono>
-
-std::chrono::time_point<std::chrono::steady_clock> start_time;
-
-void start_timer() {
-    start_time = std::chrono::steady_clock::now();
-}
-
-long long end_timer() {
-    auto end_time = std::chrono::steady_clock::now();
-    auto diff = end_time - start_time;
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count();
-}
-
-#include <thread>
-#include <mutex>
-#include <condition_variable>
+using namespace ast;
 
-// https://stackoverflow.com/questions/40550730/how-to-implement-timeout-for-function-in-c
-template <typename T>
-bool run_with_timeout(std::function<T(bool &h)> f, long long timeout, T& result, long long &time_taken) {
-    std::mutex m;
-    std::condition_variable cv;
-    bool handler = false;
-    std::thread t([&]() {
-        start_timer();
-        result = f(handler);
-        time_taken = end_timer();
-        cv.notify_one();
-    });
-    std::unique_lock<std::mutex> lk(m);
-    bool has_timeout = (cv.wait_for(lk, std::chrono::nanoseconds(timeout)) == std::cv_status::timeout);
-    if(has_timeout) {
-        handler = true;
-    }
-    t.join();
-    return !has_timeout;
+void usage() {
+    std::cerr <<
+        "usage: main [options] [suite...]      run the named suites (default: all)\n"
+        "       main --list                    list suites and engines\n"
+        "       main --compare BASELINE CURRENT [--alpha A] [--threshold T]   (CSV results only)\n"
+        "       main --serve SOCKET [--workers N] [--max-steps N] [--cache N] [--store FILE]\n"
+        "options:\n"
+        "  --min K --max K --step K   size range\n"
+        "  --size N                   generated type size (idempotent, unfolded, refutation)\n"
+        "  --iters N                  subtype calls per trial\n"
+        "  --seed S                   random seed\n"
+        "  --reps N                   trials per measurement\n"
+        "  --warmup N                 warm-up runs per measurement\n"
+        "  --timeout SECONDS          per trial\n"
+        "  --engine NAME              restrict to an engine (repeatable)\n"
+        "  --cpu C                    pin the benchmark worker to a CPU\n"
+        "  --json                     write .json instead of .txt (CSV)\n";
 }
 
-const long long ONE_SECOND = 1'000'000'000;
-
-using namespace ast;
-
-int main() {
+int main(int argc, char **argv) {
     // Set up UTF-8 output https://stackoverflow.com/questions/50053386/wcout-does-not-output-as-desired
     std::ios_base::sync_with_stdio(false);
     std::locale utf8( std::locale(), new std::codecvt_utf8_utf16<wchar_t> );
     std::wcout.imbue(utf8);
 
-    std::random_device rd;
-    std::mt19937 rng(rd());
-
-    /*** BENCHMARKS ***/
+    ResultWriter::Format format = ResultWriter::CSV;
+    int cpu = -1;
+    std::vector<const Suite*> suites;
+    std::vector<std::function<void(SuiteOptions&)>> overrides;
+    std::vector<std::string> compare_paths;
+    CompareOptions compare_options;
+    ServerOptions server_options;
+
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if(arg == "--json") {
+            format = ResultWriter::JSON;
+        } else if(arg == "--list") {
+            for(const Suite &suite : benchmark_suites()) {
+                std::cout << suite.name << ": " << suite.description << std::endl;
+            }
+            for(const Engine &engine : engines()) {
+                std::cout << "engine " << engine.name << (engine.cross_check_only ? " (cross-check only, run with --engine)" : "") << std::endl;
+            }
+            return 0;
+        } else if(arg == "--compare" && i + 2 < argc) {
+            compare_paths = {argv[i + 1], argv[i + 2]};
+            i += 2;
+        } else if(arg == "--alpha" && has_value) {
+            compare_options.alpha = atof(argv[++i]);
+        } else if(arg == "--threshold" && has_value) {
+            compare_options.threshold = atof(argv[++i]);
+        } else if(arg == "--serve" && has_value) {
+            server_options.socket_path = argv[++i];
+        } else if(arg == "--workers" && has_value) {
+            server_options.workers = atoi(argv[++i]);
+        } else if(arg == "--max-steps" && has_value) {
+            server_options.max_steps = strtoull(argv[++i], nullptr, 10);
+        } else if(arg == "--cache" && has_value) {
+            server_options.cache_capacity = strtoull(argv[++i], nullptr, 10);
+        } else if(arg == "--store" && has_value) {
+            server_options.store_path = argv[++i];
+        } else if(arg == "--cpu" && has_value) {
+            cpu = atoi(argv[++i]);
+        } else if(arg == "--min" && has_value) {
+            int v = atoi(argv[++i]);
+            overrides.push_back([v](SuiteOptions &o) { o.size_min = v; });
+        } else if(arg == "--max" && has_value) {
+            int v = atoi(argv[++i]);
+            overrides.push_back([v](SuiteOptions &o) { o.size_max = v; });
+        } else if(arg == "--step" && has_value) {
+            int v = std::max(1, atoi(argv[++i]));
+            overrides.push_back([v](SuiteOptions &o) { o.size_step = v; });
+        } else if(arg == "--size" && has_value) {
+            int v = atoi(argv[++i]);
+            overrides.push_back([v](SuiteOptions &o) { o.type_size = v; });
+        } else if(arg == "--iters" && has_value) {
+            int v = atoi(argv[++i]);
+            overrides.push_back([v](SuiteOptions &o) { o.iterations = v; });
+        } else if(arg == "--seed" && has_value) {
+            unsigned v = strtoul(argv[++i], nullptr, 10);
+            overrides.push_back([v](SuiteOptions &o) { o.seed = v; });
+        } else if(arg == "--reps" && has_value) {
+            int v = atoi(argv[++i]);
+            overrides.push_back([v](SuiteOptions &o) { o.config.trials = v; });
+        } else if(arg == "--warmup" && has_value) {
+            int v = atoi(argv[++i]);
+            overrides.push_back([v](SuiteOptions &o) { o.config.warmup = v; });
+        } else if(arg == "--timeout" && has_value) {
+            long long v = static_cast<long long>(atof(argv[++i]) * ONE_SECOND);
+            overrides.push_back([v](SuiteOptions &o) { o.config.timeout = v; });
+        } else if(arg == "--engine" && has_value) {
+            std::string name = argv[++i];
+            if(!find_engine(name)) {
+                std::cerr << "unknown engine " << name << std::endl;
+                return 2;
+            }
+            overrides.push_back([name](SuiteOptions &o) { o.engines.push_back(name); });
+        } else if(find_suite(arg)) {
+            suites.push_back(find_suite(arg));
+        } else {
+            std::cerr << "unknown argument " << arg << std::endl;
+            usage();
+            return 2;
+        }
+    }
 
-    // Exponential tests
-    for(int k = 1; k <= 10; k++) {
-        Type t1 = generate_exponential_counterexample(k);
-        Type t2 = generate_exponential_counterexample(k+1);
-        // std::wcout << t1.to_string() << std::endl;
-        // std::wcout << t2.to_string() << std::endl;
-        bool res = false;
-        long long time_taken = 0;
-        bool success;
-        success = run_with_timeout<bool>([&](bool &h){return inductive_sub::subtype(t1, t2, h);}, 10 * ONE_SECOND, res, time_taken);
-        std::cout << "inductive," << k << ',' << success << ',' << time_taken << std::endl;
-        success = run_with_timeout<bool>([&](bool &h){return coinductive_sub::subtype(t1, t2, h);}, 10 * ONE_SECOND, res, time_taken);
-        std::cout << "coinductive," << k << ',' << success << ',' << time_taken << std::endl;
+    if(!compare_paths.empty()) {
+        int regressions = compare_results(compare_paths[0], compare_paths[1], compare_options, std::cout);
+        return regressions < 0 ? 2 : regressions == 0 ? 0 : 1;
     }
 
-    // Random tests
-    for(int k = 1; k <= 100; k++) {
-        Type t1 = generate_random_isomorphic_type(k, rng);
-        Type t2 = generate_random_isomorphic_type(k, rng);
-        // std::wcout << t1.to_string() << std::endl;
-        // std::wcout << t2.to_string() << std::endl;
-        bool res = false;
-        long long time_taken = 0;
-        bool success;
-        success = run_with_timeout<bool>([&](bool &h){return inductive_sub::subtype(t1, t2, h);}, 10 * ONE_SECOND, res, time_taken);
-        std::cout << "inductive," << k << ',' << success << ',' << time_taken << std::endl;
-        success = run_with_timeout<bool>([&](bool &h){return coinductive_sub::subtype(t1, t2, h);}, 10 * ONE_SECOND, res, time_taken);
-        std::cout << "coinductive," << k << ',' << success << ',' << time_taken << std::endl;
+    if(!server_options.socket_path.empty()) {
+        return serve(server_options);
     }
 
-    // Idempotent
-    auto idemp_rng = std::mt19937(42);
-    for(int i = 0; i < 100; i++) {
-        Type t1 = generate_random_type(10000, 4, idemp_rng, true, 2);
-        bool res = false;
-        long long time_taken = 0;
-        bool success;
-        const int ITERS = 10000;
-        success = run_with_timeout<bool>([&](bool &h){volatile int x = 0; for(int i = 0; i < ITERS; i++) { x += inductive_sub::subtype(t1, t1, h);} return x;}, 10 * ONE_SECOND, res, time_taken);
-        std::cout << "inductive," << i << ',' << success << ',' << time_taken << std::endl;
-        success = run_with_timeout<bool>([&](bool &h){volatile int x = 0; for(int i = 0; i < ITERS; i++) { x += coinductive_sub::subtype(t1, t1, h);} return x;}, 10 * ONE_SECOND, res, time_taken);
-        std::cout << "coinductive," << i << ',' << success << ',' << time_taken << std::endl;
+    if(suites.empty()) {
+        for(const Suite &suite : benchmark_suites()) {
+            suites.push_back(&suite);
+        }
     }
 
-    // Unfolded
-    auto unfold_rng = std::mt19937(42);
-    for(int i = 0; i < 100; i++) {
-        Type t1, t2;
-        do {
-            t1 = generate_random_type(1000, 4, unfold_rng, true, 2);
-            // t1 = generate_random_isomorphic_type(100, unfold_rng);
-            t2 = unfold_once(t1);
-        } while (t2.nodes.size() == t1.nodes.size());
-        // std::wcout << t1.to_string() << std::endl;
+    BenchmarkRunner runner(cpu);
+
+    /*** BENCHMARKS ***/
 
-        bool res = false;
-        long long time_taken = 0;
-        bool success;
-        const int ITERS = 10000;
-        success = run_with_timeout<bool>([&](bool &h){volatile int x = 0; for(int i = 0; i < ITERS; i++) { x += inductive_sub::subtype(t1, t2, h);} return x; }, 10 * ONE_SECOND, res, time_taken);
-        std::cout << "inductive," << i << ',' << success << ',' << time_taken << std::endl;
-        success = run_with_timeout<bool>([&](bool &h){volatile int x = 0; for(int i = 0; i < ITERS; i++) { x += coinductive_sub::subtype(t1, t2, h);} return x; }, 10 * ONE_SECOND, res, time_taken);
-        std::cout << "coinductive," << i << ',' << success << ',' << time_taken << std::endl;
+    for(const Suite *suite : suites) {
+        SuiteOptions options = suite->defaults;
+        for(auto &apply : overrides) {
+            apply(options);
+        }
+        std::string path = result_file_name(*suite, format);
+        std::ofstream file(path);
+        ResultWriter out(file, format, run_metadata(*suite, options));
+        std::cerr << "running " << suite->name << " -> " << path << std::endl;
+        suite->run(runner, options, out);
     }
 }
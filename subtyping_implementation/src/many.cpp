@@ -0,0 +1,401 @@
+#include "many.hpp"
+#include "pair_set.hpp"
+#include "sort.hpp"
+
+#include <unordered_map>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+
+using namespace graph;
+
+static const uint32_t NONE = UINT32_MAX;
+
+static Participant participant_of(GraphNode *node) {
+    switch(node->type()) {
+        case TypeIn: return static_cast<In*>(node)->participant;
+        case TypeOut: return static_cast<Out*>(node)->participant;
+        case TypeBranch: return static_cast<Branch*>(node)->participant;
+        case TypeSelect: return static_cast<Select*>(node)->participant;
+        case TypeEnd: break;
+    }
+    return 0;
+}
+
+static const std::vector<std::pair<Label, GraphNode*>>* branches_of(GraphNode *node) {
+    if(node->type() == TypeBranch) return &static_cast<Branch*>(node)->branches;
+    if(node->type() == TypeSelect) return &static_cast<Select*>(node)->branches;
+    return nullptr;
+}
+
+// Hash of what a node offers by itself: kind, participant, payload and
+// labels.
+static uint64_t signature_hash(GraphNode *node) {
+    uint64_t h = splitmix64(node->type() * 31 + participant_of(node));
+    if(node->type() == TypeIn) h = splitmix64(h ^ static_cast<In*>(node)->payload);
+    if(node->type() == TypeOut) h = splitmix64(h ^ static_cast<Out*>(node)->payload);
+    if(auto branches = branches_of(node)) {
+        for(auto &branch : *branches) h = splitmix64(h ^ branch.first);
+    }
+    return h;
+}
+
+static bool same_signature(GraphNode *a, GraphNode *b) {
+    if(a->type() != b->type() || participant_of(a) != participant_of(b)) return false;
+    if(a->type() == TypeIn) return static_cast<In*>(a)->payload == static_cast<In*>(b)->payload;
+    if(a->type() == TypeOut) return static_cast<Out*>(a)->payload == static_cast<Out*>(b)->payload;
+    if(auto branches = branches_of(a)) {
+        auto &other = *branches_of(b);
+        if(branches->size() != other.size()) return false;
+        for(std::size_t i = 0; i < other.size(); i++) {
+            if((*branches)[i].first != other[i].first) return false;
+        }
+    }
+    return true;
+}
+
+namespace {
+    // The nodes reachable from the supertypes, partitioned into classes of
+    // bisimilar nodes: same kind, participant, payload and labels, and
+    // continuations in the same classes label by label.
+    struct Classes {
+        std::vector<GraphNode*> nodes;
+        std::vector<uint32_t> successors; // of node i, in label order: [first_successor[i], first_successor[i + 1])
+        std::vector<uint32_t> first_successor{0};
+        std::vector<uint32_t> class_of;
+        std::vector<uint32_t> representative; // a node of each class
+        NodeIds ids;
+
+        // Initial classes, of equal local signatures; classes whose
+        // signatures share a hash are chained.
+        std::unordered_map<uint64_t, uint32_t> by_hash;
+        std::vector<uint32_t> class_sizes, first_node, next_same_hash;
+
+        uint32_t id(GraphNode *node) {
+            return ids.number(node, nodes);
+        }
+
+        void add(GraphNode *root) {
+            std::size_t i = nodes.size();
+            id(root);
+            for(; i < nodes.size(); i++) {
+                GraphNode *node = nodes[i];
+                if(node->type() == TypeIn) successors.push_back(id(static_cast<In*>(node)->continuation));
+                if(node->type() == TypeOut) successors.push_back(id(static_cast<Out*>(node)->continuation));
+                if(auto branches = branches_of(node)) {
+                    for(auto &branch : *branches) successors.push_back(id(branch.second));
+                }
+                first_successor.push_back(successors.size());
+                class_of.push_back(initial_class(i));
+            }
+        }
+
+        // Done while the node is still in cache from numbering its
+        // continuations.
+        uint32_t initial_class(uint32_t i) {
+            auto inserted = by_hash.emplace(signature_hash(nodes[i]), NONE);
+            uint32_t c = inserted.first->second, last = NONE;
+            while(c != NONE && !same_signature(nodes[first_node[c]], nodes[i])) {
+                last = c;
+                c = next_same_hash[c];
+            }
+            if(c == NONE) {
+                c = class_sizes.size();
+                class_sizes.push_back(0);
+                first_node.push_back(i);
+                next_same_hash.push_back(NONE);
+                (last == NONE ? inserted.first->second : next_same_hash[last]) = c;
+            }
+            class_sizes[c]++;
+            return c;
+        }
+
+        void refine();
+    };
+
+    // Partition of 0..n-1 into blocks, each a range of elements. Marking
+    // moves an element to the front of its block; split() then makes the
+    // marked elements a block of their own.
+    struct Partition {
+        std::vector<uint32_t> elements, position, block_of;
+        std::vector<uint32_t> first, end, marked_end;
+        std::vector<uint32_t> touched; // blocks with marked elements
+
+        uint32_t add_block(uint32_t begin, uint32_t stop) {
+            first.push_back(begin);
+            end.push_back(stop);
+            marked_end.push_back(begin);
+            return first.size() - 1;
+        }
+
+        void mark(uint32_t x) {
+            uint32_t b = block_of[x], i = position[x], j = marked_end[b];
+            if(i < j) return;
+            if(j == first[b]) touched.push_back(b);
+            std::swap(elements[i], elements[j]);
+            position[elements[i]] = i;
+            position[elements[j]] = j;
+            marked_end[b]++;
+        }
+
+        // The new block, or NONE if every element of b was marked.
+        uint32_t split(uint32_t b) {
+            uint32_t middle = marked_end[b];
+            marked_end[b] = first[b];
+            if(middle == end[b]) return NONE;
+            uint32_t split = add_block(first[b], middle);
+            first[b] = marked_end[b] = middle;
+            for(uint32_t i = first[split]; i < end[split]; i++) block_of[elements[i]] = split;
+            return split;
+        }
+    };
+
+    // Hopcroft's algorithm, taking the edge to the j-th continuation as
+    // symbol j: the initial classes group equal local signatures, and a
+    // class is split by the predecessors of a splitter class until no
+    // splitter is left. Of the two halves of a split class only the smaller
+    // becomes a splitter unless the class was one already, so every node is
+    // in O(log n) splitters.
+    void Classes::refine() {
+        uint32_t n = nodes.size();
+        std::vector<uint32_t> first_predecessor(n + 1, 0);
+        for(uint32_t next : successors) first_predecessor[next + 1]++;
+        for(uint32_t i = 0; i < n; i++) first_predecessor[i + 1] += first_predecessor[i];
+        std::vector<std::pair<uint32_t, uint32_t>> predecessors(successors.size()); // (node, symbol)
+        std::vector<uint32_t> fill(first_predecessor.begin(), first_predecessor.end() - 1);
+        uint32_t symbols = 0;
+        for(uint32_t i = 0; i < n; i++) {
+            for(uint32_t k = first_successor[i]; k < first_successor[i + 1]; k++) {
+                uint32_t symbol = k - first_successor[i];
+                predecessors[fill[successors[k]]++] = {i, symbol};
+                symbols = std::max(symbols, symbol + 1);
+            }
+        }
+
+        Partition partition;
+        uint32_t begin = 0;
+        for(uint32_t size : class_sizes) {
+            partition.add_block(begin, begin + size);
+            begin += size;
+        }
+        partition.elements.resize(n);
+        partition.position.resize(n);
+        partition.block_of = class_of;
+        std::vector<uint32_t> fill_block(partition.first);
+        for(uint32_t i = 0; i < n; i++) {
+            uint32_t at = fill_block[class_of[i]]++;
+            partition.elements[at] = i;
+            partition.position[i] = at;
+        }
+
+        std::vector<uint32_t> splitters;
+        std::vector<char> is_splitter(class_sizes.size(), 1);
+        for(uint32_t b = 0; b < class_sizes.size(); b++) splitters.push_back(b);
+        std::vector<uint32_t> splitter;
+        std::vector<std::vector<uint32_t>> by_symbol(symbols);
+        while(!splitters.empty()) {
+            uint32_t b = splitters.back();
+            splitters.pop_back();
+            is_splitter[b] = 0;
+            splitter.assign(partition.elements.begin() + partition.first[b], partition.elements.begin() + partition.end[b]);
+            for(uint32_t x : splitter) {
+                for(uint32_t k = first_predecessor[x]; k < first_predecessor[x + 1]; k++) {
+                    by_symbol[predecessors[k].second].push_back(predecessors[k].first);
+                }
+            }
+            for(std::vector<uint32_t> &sources : by_symbol) {
+                for(uint32_t p : sources) partition.mark(p);
+                sources.clear();
+                for(uint32_t c : partition.touched) {
+                    uint32_t split = partition.split(c);
+                    if(split == NONE) continue;
+                    is_splitter.push_back(0);
+                    uint32_t smaller = partition.end[split] - partition.first[split] < partition.end[c] - partition.first[c] ? split : c;
+                    if(is_splitter[c]) smaller = split;
+                    if(!is_splitter[smaller]) {
+                        is_splitter[smaller] = 1;
+                        splitters.push_back(smaller);
+                    }
+                }
+                partition.touched.clear();
+            }
+        }
+
+        class_of = partition.block_of;
+        representative.resize(partition.first.size());
+        for(uint32_t b = 0; b < partition.first.size(); b++) representative[b] = partition.elements[partition.first[b]];
+    }
+
+    struct KeyHash {
+        std::size_t operator()(const std::pair<GraphNode*, uint32_t> &key) const {
+            return splitmix64(reinterpret_cast<int64_t>(key.first)) ^ (uint64_t(key.second) * 0x9e3779b97f4a7c15ULL);
+        }
+    };
+
+    // Exploration of the pairs (node of t1, class). A pair is Expanded once
+    // its rule has been applied and its continuation pairs pushed; it fails
+    // when its rule does or any continuation pair fails, which is passed on
+    // to every pair that needs it through the predecessor links.
+    class Product {
+        public:
+        Product(const Classes &classes, std::size_t supertypes) : classes(classes), alive(supertypes, true), next_root(supertypes, NONE) {}
+
+        enum State : uint8_t { Pending, Expanded, Failed };
+
+        struct Pair {
+            GraphNode *n1;
+            uint32_t c;
+            State state;
+            uint32_t preds; // head of the list in links
+            uint32_t roots; // first supertype rooted here, see next_root
+        };
+
+        uint32_t pair(GraphNode *n1, uint32_t c) {
+            auto inserted = ids.emplace(std::make_pair(n1, c), pairs.size());
+            if(inserted.second) pairs.push_back({n1, c, Pending, NONE, NONE});
+            return inserted.first->second;
+        }
+
+        void add_root(std::size_t supertype, uint32_t p) {
+            next_root[supertype] = pairs[p].roots;
+            pairs[p].roots = supertype;
+        }
+
+        // Explores from root until the pairs it needs are closed or one of
+        // them fails. Pairs expanded by a run that failed are put back to
+        // Pending unless they failed themselves, since their continuations
+        // may not have been explored, so every Expanded pair is part of a
+        // closed set of pairs that hold.
+        void run(uint32_t root, std::size_t supertype, const CancelToken *cancel) {
+            todo.assign(1, root);
+            expanded.clear();
+            while(!todo.empty() && alive[supertype]) {
+                if(cancel && cancel->load(std::memory_order_relaxed)) {
+                    cancelled = true;
+                    break;
+                }
+                uint32_t p = todo.back();
+                todo.pop_back();
+                if(pairs[p].state != Pending) continue;
+                pairs[p].state = Expanded;
+                expanded.push_back(p);
+                if(!apply_rule(p)) fail(p);
+            }
+            if(!alive[supertype] || cancelled) {
+                for(uint32_t p : expanded) {
+                    if(pairs[p].state == Expanded) pairs[p].state = Pending;
+                }
+            }
+        }
+
+        const Classes &classes;
+        std::vector<Pair> pairs;
+        std::vector<bool> alive; // supertypes not refuted yet
+        bool cancelled = false;
+
+        private:
+        bool apply_rule(uint32_t p) {
+            GraphNode *n1 = pairs[p].n1;
+            uint32_t node2 = classes.representative[pairs[p].c];
+            GraphNode *n2 = classes.nodes[node2];
+            const uint32_t *next2 = classes.successors.data() + classes.first_successor[node2];
+            if(n1->type() != n2->type()) return false;
+            if(n1->type() == TypeEnd) return true;
+            if(participant_of(n1) != participant_of(n2)) return false;
+            switch(n1->type()) {
+                case TypeIn: {
+                    auto in1 = static_cast<In*>(n1);
+                    return subsort(static_cast<In*>(n2)->payload, in1->payload) && follow(p, in1->continuation, next2[0]);
+                }
+                case TypeOut: {
+                    auto out1 = static_cast<Out*>(n1);
+                    return subsort(out1->payload, static_cast<Out*>(n2)->payload) && follow(p, out1->continuation, next2[0]);
+                }
+                case TypeBranch: {
+                    // Every label of the subtype must be offered by the supertype.
+                    auto &branches1 = static_cast<Branch*>(n1)->branches;
+                    auto &branches2 = static_cast<Branch*>(n2)->branches;
+                    std::size_t j = 0;
+                    for(auto &branch : branches1) {
+                        while(j < branches2.size() && branches2[j].first < branch.first) j++;
+                        if(j == branches2.size() || branches2[j].first != branch.first) return false;
+                        if(!follow(p, branch.second, next2[j])) return false;
+                    }
+                    return true;
+                }
+                case TypeSelect: {
+                    // Every label of the supertype must be selectable by the subtype.
+                    auto &branches1 = static_cast<Select*>(n1)->branches;
+                    auto &branches2 = static_cast<Select*>(n2)->branches;
+                    std::size_t i = 0;
+                    for(std::size_t j = 0; j < branches2.size(); j++) {
+                        while(i < branches1.size() && branches1[i].first < branches2[j].first) i++;
+                        if(i == branches1.size() || branches1[i].first != branches2[j].first) return false;
+                        if(!follow(p, branches1[i].second, next2[j])) return false;
+                    }
+                    return true;
+                }
+                case TypeEnd:
+                    break;
+            }
+            return true;
+        }
+
+        // Makes the pair (n1, class of node2) a continuation of from.
+        bool follow(uint32_t from, GraphNode *n1, uint32_t node2) {
+            uint32_t q = pair(n1, classes.class_of[node2]);
+            if(pairs[q].state == Failed) return false;
+            links.push_back({from, pairs[q].preds});
+            pairs[q].preds = links.size() - 1;
+            if(pairs[q].state == Pending) todo.push_back(q);
+            return true;
+        }
+
+        void fail(uint32_t p) {
+            failing.assign(1, p);
+            while(!failing.empty()) {
+                uint32_t q = failing.back();
+                failing.pop_back();
+                if(pairs[q].state == Failed) continue;
+                pairs[q].state = Failed;
+                for(uint32_t s = pairs[q].roots; s != NONE; s = next_root[s]) alive[s] = false;
+                for(uint32_t l = pairs[q].preds; l != NONE; l = links[l].second) failing.push_back(links[l].first);
+            }
+        }
+
+        std::unordered_map<std::pair<GraphNode*, uint32_t>, uint32_t, KeyHash> ids;
+        std::vector<std::pair<uint32_t, uint32_t>> links; // (predecessor, next link)
+        std::vector<uint32_t> next_root;
+        std::vector<uint32_t> todo, expanded, failing;
+    };
+}
+
+std::vector<Verdict> subtype_many(Type &t1, const std::vector<Type*> &supers, const CancelToken *cancel, ManyStats *stats) {
+    Classes classes;
+    for(Type *t : supers) classes.add(t->root);
+    classes.refine();
+
+    Product product(classes, supers.size());
+    std::vector<uint32_t> roots(supers.size());
+    for(std::size_t i = 0; i < supers.size(); i++) {
+        roots[i] = product.pair(t1.root, classes.class_of[classes.id(supers[i]->root)]);
+        product.add_root(i, roots[i]);
+    }
+
+    std::vector<Verdict> verdicts(supers.size(), Verdict::Unknown);
+    for(std::size_t i = 0; i < supers.size() && !product.cancelled; i++) {
+        if(!product.alive[i]) continue;
+        if(product.pairs[roots[i]].state != Product::Expanded) product.run(roots[i], i, cancel);
+        if(product.alive[i] && !product.cancelled) verdicts[i] = Verdict::Yes;
+    }
+    for(std::size_t i = 0; i < supers.size(); i++) {
+        if(!product.alive[i]) verdicts[i] = Verdict::No;
+    }
+
+    if(stats) {
+        stats->super_nodes = classes.nodes.size();
+        stats->classes = classes.representative.size();
+        stats->pairs = product.pairs.size();
+    }
+    return verdicts;
+}
@@ -0,0 +1,241 @@
+#include "matcher.hpp"
+#include "pair_set.hpp"
+#include "sort.hpp"
+
+#include <algorithm>
+
+using namespace graph;
+
+static const uint64_t EMPTY = ~uint64_t(0);
+
+// Candidate payload sorts that match a contract payload: contravariant for
+// inputs, covariant for outputs.
+static uint8_t allowed_sorts(Sort contract, bool in) {
+    uint8_t sorts = 0;
+    for(Sort s : {Int, Nat, Bool}) {
+        if(in ? subsort(contract, s) : subsort(s, contract)) sorts |= 1 << s;
+    }
+    return sorts;
+}
+
+CompiledContract::CompiledContract(const Type &contract) {
+    // States are numbered in BFS order from the root, which is state 0.
+    NodeIds ids;
+    std::vector<GraphNode*> nodes;
+    std::vector<Label> all_labels;
+    ids.number(contract.root, nodes);
+    for(std::size_t i = 0; i < nodes.size(); i++) {
+        GraphNode *node = nodes[i];
+        switch(node->type()) {
+            case TypeIn:
+                ids.number(static_cast<In*>(node)->continuation, nodes);
+                break;
+            case TypeOut:
+                ids.number(static_cast<Out*>(node)->continuation, nodes);
+                break;
+            case TypeBranch:
+                for(auto &branch : static_cast<Branch*>(node)->branches) {
+                    all_labels.push_back(branch.first);
+                    ids.number(branch.second, nodes);
+                }
+                break;
+            case TypeSelect:
+                for(auto &branch : static_cast<Select*>(node)->branches) {
+                    all_labels.push_back(branch.first);
+                    ids.number(branch.second, nodes);
+                }
+                break;
+            case TypeEnd:
+                break;
+        }
+    }
+    std::sort(all_labels.begin(), all_labels.end());
+    all_labels.erase(std::unique(all_labels.begin(), all_labels.end()), all_labels.end());
+    for(Label label : all_labels) {
+        label_ids.emplace(label, label_ids.size());
+    }
+
+    std::size_t n = nodes.size(), num_labels = all_labels.size();
+    label_words = (num_labels + 63) / 64;
+    state_table.resize(n);
+    bitmaps.assign(n * label_words, 0);
+    transitions.assign(n * num_labels, NONE);
+    for(std::size_t i = 0; i < n; i++) {
+        GraphNode *node = nodes[i];
+        State &state = state_table[i];
+        state = State{static_cast<uint8_t>(node->type()), 0, 0, 0, NONE};
+        auto add_branches = [&](const std::vector<std::pair<Label, GraphNode*>> &branches) {
+            for(auto &branch : branches) {
+                uint32_t label = label_ids.at(branch.first);
+                bitmaps[i * label_words + label / 64] |= uint64_t(1) << (label % 64);
+                transitions[i * num_labels + label] = ids.number(branch.second, nodes);
+            }
+            state.label_count = branches.size();
+        };
+        switch(node->type()) {
+            case TypeIn: {
+                auto in = static_cast<In*>(node);
+                state.participant = in->participant;
+                state.sorts = allowed_sorts(in->payload, true);
+                state.next = ids.number(in->continuation, nodes);
+                break;
+            }
+            case TypeOut: {
+                auto out = static_cast<Out*>(node);
+                state.participant = out->participant;
+                state.sorts = allowed_sorts(out->payload, false);
+                state.next = ids.number(out->continuation, nodes);
+                break;
+            }
+            case TypeBranch:
+                state.participant = static_cast<Branch*>(node)->participant;
+                add_branches(static_cast<Branch*>(node)->branches);
+                break;
+            case TypeSelect:
+                state.participant = static_cast<Select*>(node)->participant;
+                add_branches(static_cast<Select*>(node)->branches);
+                break;
+            case TypeEnd:
+                break;
+        }
+    }
+}
+
+std::size_t CompiledContract::table_bytes() const {
+    return state_table.size() * sizeof(State) + bitmaps.size() * sizeof(uint64_t) + transitions.size() * sizeof(uint32_t);
+}
+
+// Numbers the nodes of candidate reachable from its root, in BFS order, and
+// copies them into candidate_nodes, with their labels translated to the
+// contract's ids.
+void CompiledContract::flatten(const Type &candidate) {
+    candidate_ids.clear();
+    order.clear();
+    candidate_nodes.clear();
+    candidate_edges.clear();
+    candidate_ids.number(candidate.root, order);
+    auto add_branches = [&](const std::vector<std::pair<Label, GraphNode*>> &branches) {
+        for(auto &branch : branches) {
+            auto found = label_ids.find(branch.first);
+            candidate_edges.push_back({found == label_ids.end() ? NONE : found->second, candidate_ids.number(branch.second, order)});
+        }
+    };
+    for(std::size_t i = 0; i < order.size(); i++) {
+        GraphNode *node = order[i];
+        CandidateNode c = {static_cast<uint8_t>(node->type()), 0, 0, static_cast<uint32_t>(candidate_edges.size()), 0};
+        switch(node->type()) {
+            case TypeIn: {
+                auto in = static_cast<In*>(node);
+                c.participant = in->participant;
+                c.sort = in->payload;
+                candidate_edges.push_back({NONE, candidate_ids.number(in->continuation, order)});
+                break;
+            }
+            case TypeOut: {
+                auto out = static_cast<Out*>(node);
+                c.participant = out->participant;
+                c.sort = out->payload;
+                candidate_edges.push_back({NONE, candidate_ids.number(out->continuation, order)});
+                break;
+            }
+            case TypeBranch:
+                c.participant = static_cast<Branch*>(node)->participant;
+                add_branches(static_cast<Branch*>(node)->branches);
+                break;
+            case TypeSelect:
+                c.participant = static_cast<Select*>(node)->participant;
+                add_branches(static_cast<Select*>(node)->branches);
+                break;
+            case TypeEnd:
+                break;
+        }
+        c.edge_count = candidate_edges.size() - c.first_edge;
+        candidate_nodes.push_back(c);
+    }
+}
+
+bool CompiledContract::subtype(const Type &candidate, const CancelToken &timeout_handler) {
+    flatten(candidate);
+    sigma.reset(candidate_nodes.size(), states());
+    todo.clear();
+    auto visit = [&](uint32_t c, uint32_t s) {
+        if(sigma.insert(c, s)) todo.push_back({c, s});
+    };
+    // Every pair reachable from the roots must pass its rule, so they can be
+    // checked in any order.
+    visit(0, 0);
+    std::size_t num_labels = labels();
+    unsigned long long steps = 0;
+    while(!todo.empty()) {
+        if(++steps % 4096 == 0 && timeout_handler.load(std::memory_order_relaxed)) return false;
+        uint32_t c = todo.back().first, s = todo.back().second;
+        todo.pop_back();
+        const CandidateNode &node = candidate_nodes[c];
+        const State &state = state_table[s];
+        if(node.kind != state.kind) return false;
+        if(node.kind == TypeEnd) continue; // AS-End
+        if(node.participant != state.participant) return false;
+        const Edge *edge = &candidate_edges[node.first_edge], *end = edge + node.edge_count;
+        switch(node.kind) {
+            case TypeIn: // AS-In
+            case TypeOut: // AS-Out
+                if(!(state.sorts >> node.sort & 1)) return false;
+                visit(edge->target, state.next);
+                break;
+            case TypeBranch: // AS-Branch: every candidate label must be in the contract
+                if(node.edge_count > state.label_count) return false;
+                for(; edge != end; edge++) {
+                    if(edge->label == NONE || !has_label(s, edge->label)) return false;
+                    visit(edge->target, transitions[s * num_labels + edge->label]);
+                }
+                break;
+            case TypeSelect: { // AS-Select: every contract label must be in the candidate
+                uint32_t matched = 0;
+                for(; edge != end; edge++) {
+                    if(edge->label != NONE && has_label(s, edge->label)) {
+                        matched++;
+                        visit(edge->target, transitions[s * num_labels + edge->label]);
+                    }
+                }
+                if(matched != state.label_count) return false;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+// Pair bitmaps above this many bits fall back to hashing.
+static const std::size_t MAX_DENSE_BITS = std::size_t(1) << 26;
+
+void CompiledContract::PairMarks::reset(std::size_t candidates, std::size_t states) {
+    for(std::size_t word : dirty) words[word] = 0;
+    dirty.clear();
+    if(count > 0) std::fill(slots.begin(), slots.end(), EMPTY);
+    count = 0;
+    this->states = states;
+    dense = candidates * states <= MAX_DENSE_BITS;
+    if(dense && words.size() < (candidates * states + 63) / 64) words.resize((candidates * states + 63) / 64, 0);
+}
+
+bool CompiledContract::PairMarks::insert_hashed(uint64_t key) {
+    if(2 * (count + 1) > slots.size()) grow();
+    std::size_t mask = slots.size() - 1;
+    std::size_t i = splitmix64(key) & mask;
+    for(; slots[i] != EMPTY; i = (i + 1) & mask) {
+        if(slots[i] == key) return false;
+    }
+    slots[i] = key;
+    count++;
+    return true;
+}
+
+void CompiledContract::PairMarks::grow() {
+    std::vector<uint64_t> old;
+    old.swap(slots);
+    slots.assign(std::max<std::size_t>(64, 2 * old.size()), EMPTY);
+    count = 0;
+    for(uint64_t key : old) {
+        if(key != EMPTY) insert_hashed(key);
+    }
+}
@@ -0,0 +1,79 @@
+#include "memory.hpp"
+#include "graph.hpp"
+
+#include <algorithm>
+
+void MemoryBudget::begin_query(const void *stack_base) {
+    this->stack_base = static_cast<const char*>(stack_base);
+    heap_bytes = stack_bytes = 0;
+    peak_bytes = peak_heap_bytes = peak_stack_bytes = 0;
+    was_exceeded = false;
+}
+
+void MemoryBudget::end_query() {
+    stack_base = nullptr;
+    stack_bytes = 0;
+}
+
+void MemoryBudget::update_peak() {
+    peak_bytes = std::max(peak_bytes, current());
+    if(limit != 0 && current() > limit) {
+        was_exceeded = true;
+        throw MemoryBudgetExceeded();
+    }
+}
+
+void MemoryBudget::charge(std::size_t bytes) {
+    if(limit != 0 && current() + bytes > limit) {
+        // The caller never receives this memory, so it is not booked.
+        was_exceeded = true;
+        throw MemoryBudgetExceeded();
+    }
+    heap_bytes += bytes;
+    peak_heap_bytes = std::max(peak_heap_bytes, heap_bytes);
+    update_peak();
+}
+
+void MemoryBudget::release(std::size_t bytes) {
+    heap_bytes -= std::min(bytes, heap_bytes);
+}
+
+void MemoryBudget::note_stack(const void *marker) {
+    if(stack_base == nullptr) return;
+    // The stack grows downwards on every platform we build for.
+    const char *p = static_cast<const char*>(marker);
+    stack_bytes = p < stack_base ? stack_base - p : 0;
+    peak_stack_bytes = std::max(peak_stack_bytes, stack_bytes);
+    update_peak();
+}
+
+// Per-allocation bookkeeping of the system allocator, roughly.
+const std::size_t MALLOC_OVERHEAD = 16;
+
+std::size_t type_footprint(const Type &t) {
+    std::size_t bytes = t.nodes.capacity() * sizeof(graph::GraphNode*) + MALLOC_OVERHEAD;
+    for(graph::GraphNode *node : t.nodes) {
+        switch(node->type()) {
+            case graph::TypeIn:
+                bytes += sizeof(graph::In) + MALLOC_OVERHEAD;
+                break;
+            case graph::TypeOut:
+                bytes += sizeof(graph::Out) + MALLOC_OVERHEAD;
+                break;
+            case graph::TypeBranch: {
+                auto &branches = static_cast<graph::Branch*>(node)->branches;
+                bytes += sizeof(graph::Branch) + MALLOC_OVERHEAD + branches.capacity() * sizeof(branches[0]) + MALLOC_OVERHEAD;
+                break;
+            }
+            case graph::TypeSelect: {
+                auto &branches = static_cast<graph::Select*>(node)->branches;
+                bytes += sizeof(graph::Select) + MALLOC_OVERHEAD + branches.capacity() * sizeof(branches[0]) + MALLOC_OVERHEAD;
+                break;
+            }
+            case graph::TypeEnd:
+                bytes += sizeof(graph::End) + MALLOC_OVERHEAD;
+                break;
+        }
+    }
+    return bytes;
+}
@@ -0,0 +1,75 @@
+#include "pair_set.hpp"
+
+#include <algorithm>
+
+void FlatPairSet::grow() {
+    std::vector<NodePair> old;
+    old.swap(slots);
+    slots.assign(old.empty() ? 16 : 2 * old.size(), {nullptr, nullptr});
+    count = 0;
+    for(const NodePair &p : old) {
+        if(p.first != nullptr) insert(p);
+    }
+}
+
+// Backward-shift deletion: later entries of the probe run are moved up into
+// the hole unless their home slot lies after it, so no tombstones are needed.
+void FlatPairSet::erase(const NodePair &p) {
+    if(count == 0) return;
+    std::size_t i = home(p);
+    while(slots[i] != p) {
+        if(slots[i].first == nullptr) return;
+        i = (i + 1) & mask();
+    }
+    for(std::size_t j = (i + 1) & mask(); slots[j].first != nullptr; j = (j + 1) & mask()) {
+        std::size_t k = home(slots[j]);
+        // Move slots[j] into the hole at i if its home is not in (i, j].
+        bool between = i <= j ? (i < k && k <= j) : (i < k || k <= j);
+        if(!between) {
+            slots[i] = slots[j];
+            i = j;
+        }
+    }
+    slots[i] = {nullptr, nullptr};
+    count--;
+}
+
+uint32_t NodeIds::number(graph::GraphNode *node, std::vector<graph::GraphNode*> &order) {
+    if(2 * (count + 1) > slots.size()) grow();
+    std::size_t mask = slots.size() - 1;
+    std::size_t i = splitmix64(reinterpret_cast<int64_t>(node)) & mask;
+    for(; slots[i].first != nullptr; i = (i + 1) & mask) {
+        if(slots[i].first == node) return slots[i].second;
+    }
+    slots[i] = {node, static_cast<uint32_t>(order.size())};
+    count++;
+    order.push_back(node);
+    return slots[i].second;
+}
+
+void NodeIds::reserve(std::size_t n) {
+    std::size_t size = 64;
+    while(size < 2 * (n + 1)) size *= 2;
+    if(size > slots.size()) rehash(size);
+}
+
+void NodeIds::clear() {
+    if(count > 0) std::fill(slots.begin(), slots.end(), std::make_pair(static_cast<graph::GraphNode*>(nullptr), uint32_t(0)));
+    count = 0;
+}
+
+void NodeIds::grow() {
+    rehash(std::max<std::size_t>(64, 2 * slots.size()));
+}
+
+void NodeIds::rehash(std::size_t size) {
+    std::vector<std::pair<graph::GraphNode*, uint32_t>> old;
+    old.swap(slots);
+    slots.assign(size, {nullptr, 0});
+    for(auto &slot : old) {
+        if(slot.first == nullptr) continue;
+        std::size_t i = splitmix64(reinterpret_cast<int64_t>(slot.first)) & (slots.size() - 1);
+        while(slots[i].first != nullptr) i = (i + 1) & (slots.size() - 1);
+        slots[i] = slot;
+    }
+}
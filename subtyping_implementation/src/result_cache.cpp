@@ -0,0 +1,148 @@
+#include "result_cache.hpp"
+
+#include <iterator>
+
+using namespace graph;
+
+static std::size_t pair_count(const KnownPairs &known) {
+    return known.holds.size() + known.fails.size();
+}
+
+static void add_successors(GraphNode *node, std::vector<GraphNode*> &out) {
+    switch(node->type()) {
+        case TypeIn:
+            out.push_back(static_cast<In*>(node)->continuation);
+            break;
+        case TypeOut:
+            out.push_back(static_cast<Out*>(node)->continuation);
+            break;
+        case TypeBranch:
+            for(auto &branch : static_cast<Branch*>(node)->branches) out.push_back(branch.second);
+            break;
+        case TypeSelect:
+            for(auto &branch : static_cast<Select*>(node)->branches) out.push_back(branch.second);
+            break;
+        case TypeEnd:
+            break;
+    }
+}
+
+bool ResultCache::subtype(Type &t1, Type &t2, const CancelToken &timeout_handler, SubtypeStats *stats) {
+    auto found = index.find({&t1, &t2});
+    if(found == index.end()) {
+        entries.push_front({&t1, &t2, KnownPairs()});
+        index[{&t1, &t2}] = entries.begin();
+    } else {
+        entries.splice(entries.begin(), entries, found->second);
+    }
+    Entry &entry = entries.front();
+
+    NodePair root = {t1.root, t2.root};
+    if(entry.known.holds.count(root)) {
+        hit_count++;
+        return true;
+    }
+    if(entry.known.fails.count(root)) {
+        hit_count++;
+        return false;
+    }
+    miss_count++;
+    std::size_t before = pair_count(entry.known);
+    bool result = coinductive_sub::subtype(t1, t2, timeout_handler, entry.known, stats);
+    stored += pair_count(entry.known) - before;
+    while(stored > capacity && !entries.empty()) {
+        erase(std::prev(entries.end()));
+    }
+    return result;
+}
+
+void ResultCache::invalidate(const Type &t) {
+    for(auto it = entries.begin(); it != entries.end();) {
+        auto next = std::next(it);
+        if(it->t1 == &t || it->t2 == &t) erase(it);
+        it = next;
+    }
+}
+
+void ResultCache::invalidate(const Type &t, const std::vector<GraphNode*> &changed) {
+    std::size_t n = t.nodes.size();
+    std::unordered_map<GraphNode*, std::size_t> index;
+    index.reserve(n);
+    for(std::size_t i = 0; i < n; i++) {
+        index[t.nodes[i]] = i;
+    }
+    // Predecessor lists in one array, offsets by node.
+    std::vector<std::size_t> offset(n + 1, 0), edges;
+    std::vector<GraphNode*> successors;
+    for(std::size_t i = 0; i < n; i++) {
+        successors.clear();
+        add_successors(t.nodes[i], successors);
+        for(GraphNode *next : successors) {
+            std::size_t j = index.at(next);
+            edges.push_back(i);
+            edges.push_back(j);
+            offset[j + 1]++;
+        }
+    }
+    for(std::size_t i = 0; i < n; i++) {
+        offset[i + 1] += offset[i];
+    }
+    std::vector<std::size_t> predecessors(edges.size() / 2), fill(offset.begin(), offset.end() - 1);
+    for(std::size_t e = 0; e < edges.size(); e += 2) {
+        predecessors[fill[edges[e + 1]]++] = edges[e];
+    }
+
+    // Nodes of t that reach a changed or created node, found backwards from
+    // them. Listed nodes that are not in t were deleted.
+    std::vector<bool> affected(n, false);
+    std::vector<std::size_t> todo;
+    for(GraphNode *node : changed) {
+        auto found = index.find(node);
+        if(found != index.end() && !affected[found->second]) {
+            affected[found->second] = true;
+            todo.push_back(found->second);
+        }
+    }
+    while(!todo.empty()) {
+        std::size_t i = todo.back();
+        todo.pop_back();
+        for(std::size_t p = offset[i]; p < offset[i + 1]; p++) {
+            if(!affected[predecessors[p]]) {
+                affected[predecessors[p]] = true;
+                todo.push_back(predecessors[p]);
+            }
+        }
+    }
+    // A node that is no longer in t was deleted, whether or not it was named.
+    auto stale = [&](GraphNode *node) {
+        auto found = index.find(node);
+        return found == index.end() || affected[found->second];
+    };
+
+    for(Entry &entry : entries) {
+        bool first = entry.t1 == &t, second = entry.t2 == &t;
+        if(!first && !second) continue;
+        for(auto *pairs : {&entry.known.holds, &entry.known.fails}) {
+            for(auto it = pairs->begin(); it != pairs->end();) {
+                if((first && stale(it->first)) || (second && stale(it->second))) {
+                    it = pairs->erase(it);
+                    stored--;
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+}
+
+void ResultCache::clear() {
+    entries.clear();
+    index.clear();
+    stored = 0;
+}
+
+void ResultCache::erase(std::list<Entry>::iterator it) {
+    stored -= pair_count(it->known);
+    index.erase({it->t1, it->t2});
+    entries.erase(it);
+}
@@ -0,0 +1,187 @@
+#include "result_store.hpp"
+#include "subtyping.hpp"
+
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    struct Header {
+        char magic[8];
+        uint64_t format;
+        uint64_t engine_version;
+    };
+}
+
+struct ResultStore::Record {
+    uint64_t t1_lo, t1_hi;
+    uint64_t t2_lo, t2_hi;
+    uint64_t verdict;
+};
+
+static const char MAGIC[8] = {'S', 'U', 'B', 'S', 'T', 'O', 'R', 'E'};
+static const uint64_t FORMAT = 1;
+static const std::size_t MIN_MAP_LENGTH = 1 << 20;
+static const std::size_t MIN_SLOTS = 1024;
+
+ResultStore::ResultStore(const std::string &path, uint64_t engine_version) {
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if(fd < 0) return;
+    if(flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        fail();
+        return;
+    }
+    load(engine_version);
+}
+
+ResultStore::~ResultStore() {
+    if(map) munmap(const_cast<char*>(map), map_length);
+    fail();
+}
+
+void ResultStore::fail() {
+    if(fd >= 0) close(fd);
+    fd = -1;
+}
+
+const ResultStore::Record* ResultStore::record(uint32_t i) const {
+    return reinterpret_cast<const Record*>(map + sizeof(Header)) + i;
+}
+
+std::size_t ResultStore::find(const TypeHash &t1, const TypeHash &t2) const {
+    // The halves of canonical hashes are already well mixed.
+    std::size_t mask = slots.size() - 1;
+    std::size_t i = (t1.lo ^ (t2.lo * 0x9e3779b97f4a7c15ULL)) & mask;
+    for(; slots[i] != 0; i = (i + 1) & mask) {
+        const Record *r = record(slots[i] - 1);
+        if(r->t1_lo == t1.lo && r->t1_hi == t1.hi && r->t2_lo == t2.lo && r->t2_hi == t2.hi) break;
+    }
+    return i;
+}
+
+// Maps at least the whole records of the file. The mapping runs past the end
+// of the file, so that appended records show up in it without remapping
+// until it is full.
+bool ResultStore::map_records() {
+    std::size_t needed = sizeof(Header) + static_cast<std::size_t>(records) * sizeof(Record);
+    if(needed <= map_length) return true;
+    std::size_t length = std::max(MIN_MAP_LENGTH, 2 * needed);
+    void *fresh = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    if(fresh == MAP_FAILED) return false;
+    if(map) munmap(const_cast<char*>(map), map_length);
+    map = static_cast<const char*>(fresh);
+    map_length = length;
+    return true;
+}
+
+void ResultStore::grow_index() {
+    std::vector<uint32_t> old;
+    old.swap(slots);
+    slots.assign(2 * old.size(), 0);
+    for(uint32_t slot : old) {
+        if(slot == 0) continue;
+        const Record *r = record(slot - 1);
+        slots[find({r->t1_lo, r->t1_hi}, {r->t2_lo, r->t2_hi})] = slot;
+    }
+}
+
+// Indexes the records of a file written by engine_version, or empties a
+// store of another version and writes a new header. A file that is neither
+// empty nor a store is left alone and the store is not opened.
+void ResultStore::load(uint64_t engine_version) {
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        fail();
+        return;
+    }
+    std::size_t size = st.st_size;
+    Header header;
+    bool valid = false;
+    if(size > 0) {
+        if(size < sizeof(Header) || pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))
+            || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+            fail();
+            return;
+        }
+        valid = header.format == FORMAT && header.engine_version == engine_version;
+    }
+
+    if(valid) {
+        records = std::min<std::size_t>((size - sizeof(Header)) / sizeof(Record), UINT32_MAX - 1);
+        std::size_t whole = sizeof(Header) + static_cast<std::size_t>(records) * sizeof(Record);
+        if(whole < size && ftruncate(fd, whole) != 0) {
+            fail();
+            return;
+        }
+    } else {
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.format = FORMAT;
+        header.engine_version = engine_version;
+        if(ftruncate(fd, 0) != 0 || write(fd, &header, sizeof(header)) != static_cast<ssize_t>(sizeof(header))) {
+            fail();
+            return;
+        }
+        records = 0;
+    }
+    if(!map_records()) {
+        fail();
+        return;
+    }
+
+    std::size_t capacity = MIN_SLOTS;
+    while(capacity < 2 * (static_cast<std::size_t>(records) + 1)) capacity *= 2;
+    slots.assign(capacity, 0);
+    for(uint32_t i = 0; i < records; i++) {
+        const Record *r = record(i);
+        if(r->verdict > static_cast<uint64_t>(Verdict::Yes)) continue;
+        // A later record for the same pair wins.
+        std::size_t slot = find({r->t1_lo, r->t1_hi}, {r->t2_lo, r->t2_hi});
+        count += slots[slot] == 0;
+        slots[slot] = i + 1;
+    }
+    loaded_count = count;
+}
+
+Verdict ResultStore::lookup(const TypeHash &t1, const TypeHash &t2) {
+    uint32_t slot = slots.empty() ? 0 : slots[find(t1, t2)];
+    if(slot == 0) {
+        miss_count++;
+        return Verdict::Unknown;
+    }
+    hit_count++;
+    return static_cast<Verdict>(record(slot - 1)->verdict);
+}
+
+void ResultStore::add(const TypeHash &t1, const TypeHash &t2, Verdict verdict) {
+    if(fd < 0 || verdict == Verdict::Unknown || records >= UINT32_MAX - 1) return;
+    std::size_t slot = find(t1, t2);
+    if(slots[slot] != 0 && record(slots[slot] - 1)->verdict == static_cast<uint64_t>(verdict)) return;
+    Record r = {t1.lo, t1.hi, t2.lo, t2.hi, static_cast<uint64_t>(verdict)};
+    if(write(fd, &r, sizeof(r)) != static_cast<ssize_t>(sizeof(r))) {
+        // Whatever part was written is cut off by the next open.
+        fail();
+        return;
+    }
+    records++;
+    if(!map_records()) {
+        // The record is kept on disk and indexed by the next open.
+        fail();
+        return;
+    }
+    count += slots[slot] == 0;
+    slots[slot] = records;
+    if(2 * count > slots.size()) grow_index();
+}
+
+bool ResultStore::subtype(Type &t1, Type &t2, const CancelToken &timeout_handler, SubtypeStats *stats) {
+    TypeHash h1 = canonical_hash(t1), h2 = canonical_hash(t2);
+    Verdict known = lookup(h1, h2);
+    if(known != Verdict::Unknown) return known == Verdict::Yes;
+    bool result = coinductive_sub::subtype(t1, t2, timeout_handler, stats);
+    if(!timeout_handler.load()) add(h1, h2, result ? Verdict::Yes : Verdict::No);
+    return result;
+}
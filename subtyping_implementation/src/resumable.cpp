@@ -0,0 +1,177 @@
+#include "resumable.hpp"
+#include "sort.hpp"
+
+#include <climits>
+
+#if defined(__GNUC__)
+#define PREFETCH(address) __builtin_prefetch(address)
+#else
+#define PREFETCH(address)
+#endif
+
+using Node = graph::GraphNode;
+
+// Iterative form of check_rule in subtyping.cpp. Each visited pair costs one
+// step; a pair whose rule has children becomes a frame on the stack. Both
+// engines give up on the first refuted pair, so no result ever has to be
+// propagated back up the stack.
+struct ResumableEngine {
+    using Frame = SuspendedCheck::Frame;
+
+    enum Advance { Child, Done, Fail };
+
+    static std::unique_ptr<SuspendedCheck> start(Type &t1, Type &t2, bool inductive) {
+        auto s = std::make_unique<SuspendedCheck>();
+        s->inductive = inductive;
+        s->pending = {t1.root, t2.root};
+        return s;
+    }
+
+    // Applies the rule for (n1, n2); false if the pair is refuted.
+    static bool apply(SuspendedCheck &s, Node *n1, Node *n2) {
+        if(s.sigma.contains({n1, n2})) { // AS-Assump
+            return true;
+        }
+        if(n1->type() != n2->type()) return false;
+        switch(n1->type()) {
+            case graph::TypeEnd: // AS-End
+                return true;
+            case graph::TypeIn: { // AS-In
+                auto in1 = static_cast<graph::In*>(n1);
+                auto in2 = static_cast<graph::In*>(n2);
+                if(in1->participant != in2->participant || !subsort(in2->payload, in1->payload)) return false;
+                break;
+            }
+            case graph::TypeOut: { // AS-Out
+                auto out1 = static_cast<graph::Out*>(n1);
+                auto out2 = static_cast<graph::Out*>(n2);
+                if(out1->participant != out2->participant || !subsort(out1->payload, out2->payload)) return false;
+                break;
+            }
+            case graph::TypeBranch: // AS-Branch
+                if(static_cast<graph::Branch*>(n1)->participant != static_cast<graph::Branch*>(n2)->participant) return false;
+                break;
+            case graph::TypeSelect: // AS-Select
+                if(static_cast<graph::Select*>(n1)->participant != static_cast<graph::Select*>(n2)->participant) return false;
+                break;
+        }
+        s.sigma.insert({n1, n2});
+        s.stack.push_back({n1, n2, 0, 0});
+        return true;
+    }
+
+    // Finds the next child pair of a frame, matching labels as check_rule does.
+    static Advance advance(Frame &f, NodePair &child) {
+        switch(f.n1->type()) {
+            case graph::TypeIn:
+                if(f.next++ > 0) return Done;
+                child = {static_cast<graph::In*>(f.n1)->continuation, static_cast<graph::In*>(f.n2)->continuation};
+                return Child;
+            case graph::TypeOut:
+                if(f.next++ > 0) return Done;
+                child = {static_cast<graph::Out*>(f.n1)->continuation, static_cast<graph::Out*>(f.n2)->continuation};
+                return Child;
+            case graph::TypeBranch: {
+                // All branches of n1 must be matched by branches of n2
+                auto &b1 = static_cast<graph::Branch*>(f.n1)->branches;
+                auto &b2 = static_cast<graph::Branch*>(f.n2)->branches;
+                if(f.next >= b1.size()) return Done;
+                while(f.other < b2.size() && b2[f.other].first < b1[f.next].first) {
+                    f.other++;
+                }
+                if(f.other >= b2.size() || b2[f.other].first != b1[f.next].first) return Fail;
+                child = {b1[f.next].second, b2[f.other].second};
+                f.next++;
+                return Child;
+            }
+            case graph::TypeSelect: {
+                // All branches of n2 must be matched by branches of n1
+                auto &s1 = static_cast<graph::Select*>(f.n1)->branches;
+                auto &s2 = static_cast<graph::Select*>(f.n2)->branches;
+                if(f.next >= s2.size()) return Done;
+                while(f.other < s1.size() && s1[f.other].first < s2[f.next].first) {
+                    f.other++;
+                }
+                if(f.other >= s1.size() || s1[f.other].first != s2[f.next].first) return Fail;
+                child = {s1[f.other].second, s2[f.next].second};
+                f.next++;
+                return Child;
+            }
+            case graph::TypeEnd:
+                return Done;
+        }
+        return Fail;
+    }
+
+    // One transition: applies the rule for the pending pair, or moves the top
+    // frame on to its next child. Unknown while the check is still running.
+    static Verdict step(SuspendedCheck &s) {
+        if(s.pending.first != nullptr) {
+            s.steps++;
+            NodePair pair = s.pending;
+            s.pending = {nullptr, nullptr};
+            return apply(s, pair.first, pair.second) ? Verdict::Unknown : Verdict::No;
+        }
+        if(s.stack.empty()) return Verdict::Yes;
+        Frame &top = s.stack.back();
+        switch(advance(top, s.pending)) {
+            case Child:
+                break;
+            case Fail:
+                return Verdict::No;
+            case Done:
+                if(s.inductive) s.sigma.erase({top.n1, top.n2});
+                s.stack.pop_back();
+                break;
+        }
+        return Verdict::Unknown;
+    }
+
+    static BudgetedResult run(std::unique_ptr<SuspendedCheck> s, unsigned long long steps) {
+        unsigned long long limit = steps > ULLONG_MAX - s->steps ? ULLONG_MAX : s->steps + steps;
+        while(true) {
+            if(s->pending.first != nullptr && s->steps == limit) return {Verdict::Unknown, std::move(s)};
+            Verdict verdict = step(*s);
+            if(verdict != Verdict::Unknown) return {verdict, nullptr};
+        }
+    }
+
+    static Verdict run_to_next_pair(SuspendedCheck &s) {
+        do {
+            Verdict verdict = step(s);
+            if(verdict != Verdict::Unknown) return verdict;
+        } while(s.pending.first == nullptr);
+        PREFETCH(s.sigma.probe_address(s.pending));
+        PREFETCH(s.pending.first);
+        PREFETCH(s.pending.second);
+        return Verdict::Unknown;
+    }
+};
+
+namespace inductive_sub {
+    BudgetedResult subtype(Type &t1, Type &t2, unsigned long long steps) {
+        return ResumableEngine::run(ResumableEngine::start(t1, t2, true), steps);
+    }
+}
+
+namespace coinductive_sub {
+    BudgetedResult subtype(Type &t1, Type &t2, unsigned long long steps) {
+        return ResumableEngine::run(ResumableEngine::start(t1, t2, false), steps);
+    }
+}
+
+BudgetedResult resume(std::unique_ptr<SuspendedCheck> suspended, unsigned long long steps) {
+    return ResumableEngine::run(std::move(suspended), steps);
+}
+
+std::unique_ptr<SuspendedCheck> start_check(Type &t1, Type &t2, bool inductive) {
+    return ResumableEngine::start(t1, t2, inductive);
+}
+
+Verdict step(SuspendedCheck &check) {
+    return ResumableEngine::step(check);
+}
+
+Verdict run_to_next_pair(SuspendedCheck &check) {
+    return ResumableEngine::run_to_next_pair(check);
+}
@@ -0,0 +1,174 @@
+#include "serialize.hpp"
+#include "graph.hpp"
+#include "sort.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+using namespace graph;
+
+template <typename T>
+void put(std::string &out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void serialize(const Type &t, std::string &out) {
+    std::unordered_map<GraphNode*, uint32_t> index;
+    for(size_t i = 0; i < t.nodes.size(); i++) {
+        index[t.nodes[i]] = i;
+    }
+    put<uint32_t>(out, t.nodes.size());
+    put<uint32_t>(out, index[t.root]);
+    for(GraphNode *node : t.nodes) {
+        put<uint8_t>(out, node->type());
+        switch(node->type()) {
+            case TypeIn: {
+                In *in = static_cast<In*>(node);
+                put<int32_t>(out, in->participant);
+                put<uint8_t>(out, in->payload);
+                put<uint32_t>(out, index[in->continuation]);
+                break;
+            }
+            case TypeOut: {
+                Out *o = static_cast<Out*>(node);
+                put<int32_t>(out, o->participant);
+                put<uint8_t>(out, o->payload);
+                put<uint32_t>(out, index[o->continuation]);
+                break;
+            }
+            case TypeBranch:
+            case TypeSelect: {
+                bool branch = node->type() == TypeBranch;
+                Participant participant = branch ? static_cast<Branch*>(node)->participant : static_cast<Select*>(node)->participant;
+                auto &branches = branch ? static_cast<Branch*>(node)->branches : static_cast<Select*>(node)->branches;
+                put<int32_t>(out, participant);
+                put<uint32_t>(out, branches.size());
+                for(auto &b : branches) {
+                    put<int32_t>(out, b.first);
+                    put<uint32_t>(out, index[b.second]);
+                }
+                break;
+            }
+            case TypeEnd:
+                break;
+        }
+    }
+}
+
+// Bounds-checked reads over the input.
+struct Reader {
+    const char *data;
+    std::size_t size;
+    std::size_t pos = 0;
+
+    template <typename T>
+    bool get(T &value) {
+        if(size - pos < sizeof(T)) return false;
+        std::memcpy(&value, data + pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+};
+
+static bool decode(Reader &in, Type &t) {
+    uint32_t count, root;
+    if(!in.get(count) || !in.get(root) || root >= count) return false;
+    // Every node takes at least one byte, which bounds count before allocating.
+    if(count > in.size - in.pos) return false;
+
+    // Nodes are created first and linked afterwards, as targets may point forwards.
+    std::vector<std::pair<GraphNode**, uint32_t>> links;
+    t.nodes.reserve(count);
+    for(uint32_t i = 0; i < count; i++) {
+        uint8_t kind;
+        int32_t participant;
+        if(!in.get(kind)) return false;
+        switch(kind) {
+            case TypeIn:
+            case TypeOut: {
+                uint8_t payload;
+                uint32_t next;
+                if(!in.get(participant) || !in.get(payload) || !in.get(next)) return false;
+                if(payload > Bool || next >= count) return false;
+                if(kind == TypeIn) {
+                    In *node = new In(participant);
+                    t.nodes.push_back(node);
+                    node->payload = static_cast<Sort>(payload);
+                    links.push_back({&node->continuation, next});
+                } else {
+                    Out *node = new Out(participant);
+                    t.nodes.push_back(node);
+                    node->payload = static_cast<Sort>(payload);
+                    links.push_back({&node->continuation, next});
+                }
+                break;
+            }
+            case TypeBranch:
+            case TypeSelect: {
+                uint32_t labels;
+                if(!in.get(participant) || !in.get(labels)) return false;
+                if(labels > (in.size - in.pos) / 8) return false;
+                std::vector<std::pair<Label, GraphNode*>> *branches;
+                if(kind == TypeBranch) {
+                    Branch *node = new Branch(participant);
+                    t.nodes.push_back(node);
+                    branches = &node->branches;
+                } else {
+                    Select *node = new Select(participant);
+                    t.nodes.push_back(node);
+                    branches = &node->branches;
+                }
+                branches->resize(labels);
+                for(uint32_t j = 0; j < labels; j++) {
+                    int32_t label;
+                    uint32_t next;
+                    if(!in.get(label) || !in.get(next) || next >= count) return false;
+                    if(j > 0 && label <= (*branches)[j - 1].first) return false; // branches must be sorted
+                    (*branches)[j].first = label;
+                    links.push_back({&(*branches)[j].second, next});
+                }
+                break;
+            }
+            case TypeEnd:
+                t.nodes.push_back(new End());
+                break;
+            default:
+                return false;
+        }
+    }
+    if(in.pos != in.size) return false;
+
+    for(auto &link : links) {
+        *link.first = t.nodes[link.second];
+    }
+    t.root = t.nodes[root];
+    return true;
+}
+
+bool deserialize(const char *data, std::size_t size, Type &t) {
+    Reader in{data, size};
+    if(decode(in, t)) return true;
+    for(GraphNode *node : t.nodes) {
+        delete node;
+    }
+    t.nodes.clear();
+    t.root = nullptr;
+    return false;
+}
+
+void write_type(std::ostream &out, const Type &t) {
+    std::string record(sizeof(uint32_t), '\0');
+    serialize(t, record);
+    uint32_t length = record.size() - sizeof(uint32_t);
+    std::memcpy(&record[0], &length, sizeof(length));
+    out.write(record.data(), record.size());
+}
+
+bool read_type(std::istream &in, Type &t) {
+    uint32_t length;
+    if(!in.read(reinterpret_cast<char*>(&length), sizeof(length)) || length > MAX_RECORD) return false;
+    std::string data(length, '\0');
+    if(!in.read(&data[0], length)) return false;
+    return deserialize(data.data(), data.size(), t);
+}
@@ -0,0 +1,403 @@
+#include "server.hpp"
+#include "serialize.hpp"
+#include "resumable.hpp"
+#include "compact.hpp"
+#include "type.hpp"
+#include "type_hash.hpp"
+#include "result_store.hpp"
+
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <deque>
+#include <unordered_map>
+#include <climits>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace protocol {
+    void encode(const Frame &frame, std::string &out) {
+        uint32_t length = frame.payload.size();
+        out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        out.append(reinterpret_cast<const char*>(&frame.tag), sizeof(frame.tag));
+        out.push_back(static_cast<char>(frame.code));
+        out += frame.payload;
+    }
+
+    bool write_all(int fd, const std::string &data) {
+        std::size_t done = 0;
+        while(done < data.size()) {
+            ssize_t n = send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+            if(n < 0 && errno == EINTR) continue;
+            if(n <= 0) return false;
+            done += n;
+        }
+        return true;
+    }
+
+    bool FrameReader::fill(std::size_t bytes) {
+        if(buffer.size() - pos >= bytes) return true;
+        buffer.erase(0, pos);
+        pos = 0;
+        char chunk[1 << 16];
+        while(buffer.size() < bytes) {
+            ssize_t n = read(fd, chunk, sizeof(chunk));
+            if(n < 0 && errno == EINTR) continue;
+            if(n <= 0) return false;
+            buffer.append(chunk, n);
+        }
+        return true;
+    }
+
+    bool FrameReader::next(Frame &frame) {
+        if(!fill(HEADER_SIZE)) return false;
+        uint32_t length;
+        std::memcpy(&length, buffer.data() + pos, sizeof(length));
+        std::memcpy(&frame.tag, buffer.data() + pos + 4, sizeof(frame.tag));
+        frame.code = static_cast<uint8_t>(buffer[pos + 8]);
+        if(length > MAX_PAYLOAD || !fill(HEADER_SIZE + length)) return false;
+        frame.payload.assign(buffer, pos + HEADER_SIZE, length);
+        pos += HEADER_SIZE + length;
+        return true;
+    }
+
+    void put_id(std::string &out, uint64_t id) {
+        out.append(reinterpret_cast<const char*>(&id), sizeof(id));
+    }
+
+    bool get_id(const std::string &payload, std::size_t i, uint64_t &id) {
+        if(payload.size() < (i + 1) * sizeof(id)) return false;
+        std::memcpy(&id, payload.data() + i * sizeof(id), sizeof(id));
+        return true;
+    }
+}
+
+// Responses of one connection waiting to be sent. Only the connection's own
+// writer thread sends them, so a client that stops reading stalls that
+// thread and never a worker.
+struct Outbox {
+    int fd;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::string pending;
+    bool closed = false; // no more responses will come
+    bool broken = false; // the client has gone away
+};
+
+// Sends responses until the connection is closed and everything queued has
+// gone out, then closes the socket.
+static void drain(std::shared_ptr<Outbox> outbox) {
+    std::string out;
+    std::unique_lock<std::mutex> lock(outbox->mutex);
+    while(true) {
+        outbox->cv.wait(lock, [&] { return !outbox->pending.empty() || outbox->closed; });
+        if(outbox->pending.empty()) break;
+        out.clear();
+        out.swap(outbox->pending);
+        outbox->cv.notify_all(); // the reader may be waiting for room
+        lock.unlock();
+        bool sent = outbox->broken || protocol::write_all(outbox->fd, out);
+        lock.lock();
+        // Responses for a vanished client are dropped; its reader notices too.
+        outbox->broken = !sent;
+    }
+    close(outbox->fd);
+}
+
+// Pending responses above which a connection's reader stops taking requests
+// until its client reads.
+static const std::size_t MAX_PENDING = 1 << 24;
+
+struct Connection {
+    int fd;
+    std::shared_ptr<Outbox> outbox;
+
+    explicit Connection(int fd) : fd(fd), outbox(std::make_shared<Outbox>()) {
+        outbox->fd = fd;
+        std::thread(drain, outbox).detach();
+    }
+    ~Connection() {
+        std::lock_guard<std::mutex> lock(outbox->mutex);
+        outbox->closed = true;
+        outbox->cv.notify_all();
+    }
+
+    void respond(uint32_t tag, protocol::Status status, const std::string &payload = "") {
+        protocol::Frame frame;
+        frame.tag = tag;
+        frame.code = status;
+        frame.payload = payload;
+        std::lock_guard<std::mutex> lock(outbox->mutex);
+        if(outbox->broken) return;
+        protocol::encode(frame, outbox->pending);
+        outbox->cv.notify_all();
+    }
+
+    // Blocks the reader while the client is too far behind in reading.
+    void wait_for_room() {
+        std::unique_lock<std::mutex> lock(outbox->mutex);
+        outbox->cv.wait(lock, [&] { return outbox->pending.size() < MAX_PENDING || outbox->broken; });
+    }
+};
+
+// A subtype or equivalence query waiting for a worker. It holds on to its
+// types, so a later Drop does not pull them away.
+struct Check {
+    std::shared_ptr<Connection> connection;
+    uint32_t tag;
+    bool equivalent;
+    uint64_t id1, id2;
+    std::shared_ptr<Type> t1, t2;
+    TypeHash h1, h2;
+};
+
+// A registered type, with its canonical hash if the server has a store.
+struct Registered {
+    std::shared_ptr<Type> type;
+    TypeHash hash = {0, 0};
+};
+
+struct IdPairHash {
+    std::size_t operator()(const std::pair<uint64_t, uint64_t> &p) const {
+        return std::hash<uint64_t>()(p.first * 0x9e3779b97f4a7c15ull ^ p.second);
+    }
+};
+
+class Server {
+    public:
+    explicit Server(const ServerOptions &options) : options(options) {}
+
+    int run() {
+        if(!options.store_path.empty()) {
+            store = std::make_unique<ResultStore>(options.store_path);
+            if(!store->is_open()) {
+                std::cerr << "cannot open store " << options.store_path << std::endl;
+                return 1;
+            }
+        }
+
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if(options.socket_path.size() >= sizeof(address.sun_path)) {
+            std::cerr << "socket path too long: " << options.socket_path << std::endl;
+            return 1;
+        }
+        std::strcpy(address.sun_path, options.socket_path.c_str());
+        // Only a socket left by an earlier server is replaced, so that a
+        // mistyped path cannot delete a file.
+        struct stat st;
+        if(lstat(options.socket_path.c_str(), &st) == 0) {
+            if(!S_ISSOCK(st.st_mode)) {
+                std::cerr << "cannot listen on " << options.socket_path << ": path exists and is not a socket" << std::endl;
+                return 1;
+            }
+            unlink(options.socket_path.c_str());
+        }
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listener, 128) < 0) {
+            std::cerr << "cannot listen on " << options.socket_path << ": " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+
+        int workers = options.workers > 0 ? options.workers : std::max(1u, std::thread::hardware_concurrency());
+        for(int i = 0; i < workers; i++) {
+            std::thread([this] { work(); }).detach();
+        }
+        std::cerr << "serving on " << options.socket_path << " with " << workers << " workers" << std::endl;
+
+        while(true) {
+            int fd = accept(listener, nullptr, nullptr);
+            if(fd < 0) {
+                if(errno == EINTR || errno == ECONNABORTED) continue;
+                std::cerr << "accept failed: " << std::strerror(errno) << std::endl;
+                close(listener);
+                return 1;
+            }
+            auto connection = std::make_shared<Connection>(fd);
+            std::thread([this, connection] { read_requests(connection); }).detach();
+        }
+    }
+
+    private:
+    // Registry and cache updates are answered directly by the connection's
+    // reader, which keeps them in request order; only checks that miss the
+    // cache go to the workers.
+    void read_requests(std::shared_ptr<Connection> connection) {
+        protocol::FrameReader reader(connection->fd);
+        protocol::Frame request;
+        while(reader.next(request)) {
+            connection->wait_for_room();
+            switch(request.code) {
+                case protocol::Register: {
+                    Registered entry;
+                    entry.type = std::make_shared<Type>();
+                    if(!deserialize(request.payload.data(), request.payload.size(), *entry.type)) {
+                        connection->respond(request.tag, protocol::Malformed);
+                        break;
+                    }
+                    // Registered types are checked many times; lay them out
+                    // and hash them once.
+                    compact(*entry.type);
+                    if(store) entry.hash = canonical_hash(*entry.type);
+                    uint64_t id;
+                    {
+                        std::unique_lock<std::shared_mutex> lock(registry_mutex);
+                        id = next_id++;
+                        registry[id] = std::move(entry);
+                    }
+                    std::string payload;
+                    protocol::put_id(payload, id);
+                    connection->respond(request.tag, protocol::Ok, payload);
+                    break;
+                }
+                case protocol::Drop: {
+                    uint64_t id;
+                    if(!protocol::get_id(request.payload, 0, id)) {
+                        connection->respond(request.tag, protocol::Malformed);
+                        break;
+                    }
+                    std::unique_lock<std::shared_mutex> lock(registry_mutex);
+                    bool found = registry.erase(id) > 0;
+                    lock.unlock();
+                    connection->respond(request.tag, found ? protocol::Ok : protocol::UnknownType);
+                    break;
+                }
+                case protocol::Subtype:
+                case protocol::Equivalent: {
+                    Check check;
+                    check.connection = connection;
+                    check.tag = request.tag;
+                    check.equivalent = request.code == protocol::Equivalent;
+                    if(!protocol::get_id(request.payload, 0, check.id1) || !protocol::get_id(request.payload, 1, check.id2)) {
+                        connection->respond(request.tag, protocol::Malformed);
+                        break;
+                    }
+                    {
+                        std::shared_lock<std::shared_mutex> lock(registry_mutex);
+                        auto it1 = registry.find(check.id1), it2 = registry.find(check.id2);
+                        if(it1 != registry.end() && it2 != registry.end()) {
+                            check.t1 = it1->second.type;
+                            check.t2 = it2->second.type;
+                            check.h1 = it1->second.hash;
+                            check.h2 = it2->second.hash;
+                        }
+                    }
+                    if(!check.t1) {
+                        connection->respond(request.tag, protocol::UnknownType);
+                        break;
+                    }
+                    Verdict verdict;
+                    if(cached_answer(check, verdict)) {
+                        connection->respond(request.tag, protocol::Ok, std::string(1, static_cast<char>(verdict)));
+                        break;
+                    }
+                    {
+                        std::lock_guard<std::mutex> lock(queue_mutex);
+                        queue.push_back(std::move(check));
+                    }
+                    queue_cv.notify_one();
+                    break;
+                }
+                default:
+                    connection->respond(request.tag, protocol::Malformed);
+                    break;
+            }
+        }
+    }
+
+    void work() {
+        while(true) {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_cv.wait(lock, [this] { return !queue.empty(); });
+            Check check = std::move(queue.front());
+            queue.pop_front();
+            lock.unlock();
+
+            Verdict verdict = decide(check.id1, *check.t1, check.h1, check.id2, *check.t2, check.h2);
+            if(check.equivalent && verdict == Verdict::Yes) {
+                verdict = decide(check.id2, *check.t2, check.h2, check.id1, *check.t1, check.h1);
+            }
+            check.connection->respond(check.tag, protocol::Ok, std::string(1, static_cast<char>(verdict)));
+        }
+    }
+
+    // Looks up id1 <= id2 in the cache; Unknown if it is not there.
+    Verdict lookup(uint64_t id1, uint64_t id2) {
+        if(id1 == id2) return Verdict::Yes;
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        auto it = cache.find({id1, id2});
+        return it == cache.end() ? Verdict::Unknown : it->second ? Verdict::Yes : Verdict::No;
+    }
+
+    bool cached_answer(const Check &check, Verdict &verdict) {
+        verdict = lookup(check.id1, check.id2);
+        if(check.equivalent && verdict == Verdict::Yes) {
+            verdict = lookup(check.id2, check.id1);
+        }
+        return verdict != Verdict::Unknown;
+    }
+
+    void remember(uint64_t id1, uint64_t id2, Verdict verdict) {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        if(cache.size() >= options.cache_capacity) cache.clear();
+        cache[{id1, id2}] = verdict == Verdict::Yes;
+    }
+
+    // Consults the cache, then the store, and only then runs a check.
+    Verdict decide(uint64_t id1, Type &t1, const TypeHash &h1, uint64_t id2, Type &t2, const TypeHash &h2) {
+        Verdict verdict = lookup(id1, id2);
+        if(verdict != Verdict::Unknown) return verdict;
+        if(store) {
+            std::lock_guard<std::mutex> lock(store_mutex);
+            verdict = store->lookup(h1, h2);
+        }
+        if(verdict != Verdict::Unknown) {
+            remember(id1, id2, verdict);
+            return verdict;
+        }
+        // The step-budgeted engine runs on an explicit stack, so large types
+        // cannot overflow a worker's stack.
+        unsigned long long steps = options.max_steps ? options.max_steps : ULLONG_MAX;
+        verdict = coinductive_sub::subtype(t1, t2, steps).verdict;
+        if(verdict != Verdict::Unknown) {
+            remember(id1, id2, verdict);
+            if(store) {
+                std::lock_guard<std::mutex> lock(store_mutex);
+                store->add(h1, h2, verdict);
+            }
+        }
+        return verdict;
+    }
+
+    ServerOptions options;
+
+    std::shared_mutex registry_mutex;
+    std::unordered_map<uint64_t, Registered> registry;
+    uint64_t next_id = 1;
+
+    // IDs are never reused, so entries of dropped types are merely dead.
+    std::mutex cache_mutex;
+    std::unordered_map<std::pair<uint64_t, uint64_t>, bool, IdPairHash> cache;
+
+    // Verdicts kept across restarts, keyed by canonical hash.
+    std::mutex store_mutex;
+    std::unique_ptr<ResultStore> store;
+
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::deque<Check> queue;
+};
+
+int serve(const ServerOptions &options) {
+    // Never freed: the detached workers and readers may still use it.
+    Server *server = new Server(options);
+    return server->run();
+}
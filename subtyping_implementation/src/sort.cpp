@@ -8,7 +8,3 @@ std::wstring to_string(Sort sort) {
     }
     return L"";
 }
-
-bool subsort(Sort s1, Sort s2) {
-    return s1 == s2 || (s1 == Nat && s2 == Int);
-}
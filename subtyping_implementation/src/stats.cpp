@@ -0,0 +1,71 @@
+#include "stats.hpp"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#include <cstdint>
+
+static int open_counter(uint64_t config, int group_fd) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = group_fd < 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    // pid = 0, cpu = -1: count the calling thread on any CPU.
+    return syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+PerfCounters::PerfCounters() {
+    group_fd = open_counter(PERF_COUNT_HW_CPU_CYCLES, -1);
+    if(group_fd < 0) return;
+    cache_fd = open_counter(PERF_COUNT_HW_CACHE_MISSES, group_fd);
+    branch_fd = open_counter(PERF_COUNT_HW_BRANCH_MISSES, group_fd);
+    if(cache_fd < 0 || branch_fd < 0) {
+        if(cache_fd >= 0) close(cache_fd);
+        if(branch_fd >= 0) close(branch_fd);
+        close(group_fd);
+        group_fd = cache_fd = branch_fd = -1;
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    if(group_fd < 0) return;
+    close(branch_fd);
+    close(cache_fd);
+    close(group_fd);
+}
+
+void PerfCounters::start() {
+    if(group_fd < 0) return;
+    ioctl(group_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+HardwareCounters PerfCounters::stop() {
+    HardwareCounters result;
+    if(group_fd < 0) return result;
+    ioctl(group_fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    uint64_t values[4]; // nr, cycles, cache misses, branch misses
+    if(read(group_fd, values, sizeof(values)) != sizeof(values) || values[0] != 3) return result;
+    result.available = true;
+    result.cycles = values[1];
+    result.cache_misses = values[2];
+    result.branch_misses = values[3];
+    return result;
+}
+
+#else
+
+PerfCounters::PerfCounters() {}
+PerfCounters::~PerfCounters() {}
+void PerfCounters::start() {}
+HardwareCounters PerfCounters::stop() { return HardwareCounters(); }
+
+#endif
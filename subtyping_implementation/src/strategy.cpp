@@ -0,0 +1,299 @@
+#include "strategy.hpp"
+#include "graph.hpp"
+#include "pair_set.hpp"
+#include "sort.hpp"
+
+#include <deque>
+#include <unordered_map>
+#include <algorithm>
+
+using Node = graph::GraphNode;
+
+const std::vector<Strategy>& all_strategies() {
+    static const std::vector<Strategy> all = {
+        Strategy::LabelOrder, Strategy::BreadthFirst, Strategy::ShallowestFirst, Strategy::CheapestFirst,
+    };
+    return all;
+}
+
+const char* strategy_name(Strategy strategy) {
+    switch(strategy) {
+        case Strategy::LabelOrder: return "label-order";
+        case Strategy::BreadthFirst: return "bfs";
+        case Strategy::ShallowestFirst: return "shallowest";
+        case Strategy::CheapestFirst: return "cheapest";
+    }
+    return "unknown";
+}
+
+bool parse_strategy(const std::string &name, Strategy &strategy) {
+    for(Strategy candidate : all_strategies()) {
+        if(name == strategy_name(candidate)) {
+            strategy = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void add_successors(Node *node, std::vector<Node*> &out) {
+    switch(node->type()) {
+        case graph::TypeIn:
+            out.push_back(static_cast<graph::In*>(node)->continuation);
+            break;
+        case graph::TypeOut:
+            out.push_back(static_cast<graph::Out*>(node)->continuation);
+            break;
+        case graph::TypeBranch:
+            for(auto &b : static_cast<graph::Branch*>(node)->branches) out.push_back(b.second);
+            break;
+        case graph::TypeSelect:
+            for(auto &b : static_cast<graph::Select*>(node)->branches) out.push_back(b.second);
+            break;
+        case graph::TypeEnd:
+            break;
+    }
+}
+
+// Length of the shortest path from each node of t to an end node, found by a
+// backwards BFS from the end nodes. Nodes that cannot reach one are put one
+// above the highest of the others.
+static void add_heights(const Type &t, std::unordered_map<Node*, unsigned> &height) {
+    std::size_t n = t.nodes.size();
+    std::unordered_map<Node*, std::size_t> index;
+    index.reserve(n);
+    for(std::size_t i = 0; i < n; i++) {
+        index[t.nodes[i]] = i;
+    }
+    // Predecessor lists in one array, offsets by node.
+    std::vector<std::size_t> edges_from, edges_to, offset(n + 1, 0);
+    std::vector<Node*> next;
+    for(std::size_t i = 0; i < n; i++) {
+        next.clear();
+        add_successors(t.nodes[i], next);
+        for(Node *s : next) {
+            edges_from.push_back(i);
+            edges_to.push_back(index[s]);
+            offset[index[s] + 1]++;
+        }
+    }
+    for(std::size_t i = 0; i < n; i++) {
+        offset[i + 1] += offset[i];
+    }
+    std::vector<std::size_t> preds(edges_from.size()), fill(offset.begin(), offset.end() - 1);
+    for(std::size_t e = 0; e < edges_from.size(); e++) {
+        preds[fill[edges_to[e]]++] = edges_from[e];
+    }
+
+    std::vector<unsigned> h(n, n);
+    std::deque<std::size_t> todo;
+    for(std::size_t i = 0; i < n; i++) {
+        if(t.nodes[i]->type() == graph::TypeEnd) {
+            h[i] = 0;
+            todo.push_back(i);
+        }
+    }
+    unsigned highest = 0;
+    while(!todo.empty()) {
+        std::size_t i = todo.front();
+        todo.pop_front();
+        highest = h[i];
+        for(std::size_t p = offset[i]; p < offset[i + 1]; p++) {
+            if(h[preds[p]] == n) {
+                h[preds[p]] = h[i] + 1;
+                todo.push_back(preds[p]);
+            }
+        }
+    }
+    for(std::size_t i = 0; i < n; i++) {
+        height[t.nodes[i]] = h[i] == n ? highest + 1 : h[i];
+    }
+}
+
+// Local part of the rule for (n1, n2): constructors, participants, payloads
+// and labels. Appends the pairs the rule continues with to children, in label
+// order; false if the pair is refuted.
+static bool expand(Node *n1, Node *n2, std::vector<NodePair> &children, SubtypeStats *stats) {
+    if(n1->type() != n2->type()) return false;
+    switch(n1->type()) {
+        case graph::TypeEnd: // AS-End
+            STAT(stats, stats->rules[SubtypeStats::AS_End]++);
+            return true;
+        case graph::TypeIn: { // AS-In
+            STAT(stats, stats->rules[SubtypeStats::AS_In]++);
+            auto in1 = static_cast<graph::In*>(n1);
+            auto in2 = static_cast<graph::In*>(n2);
+            if(in1->participant != in2->participant || !subsort(in2->payload, in1->payload)) return false;
+            children.push_back({in1->continuation, in2->continuation});
+            return true;
+        }
+        case graph::TypeOut: { // AS-Out
+            STAT(stats, stats->rules[SubtypeStats::AS_Out]++);
+            auto out1 = static_cast<graph::Out*>(n1);
+            auto out2 = static_cast<graph::Out*>(n2);
+            if(out1->participant != out2->participant || !subsort(out1->payload, out2->payload)) return false;
+            children.push_back({out1->continuation, out2->continuation});
+            return true;
+        }
+        case graph::TypeBranch: { // AS-Branch
+            STAT(stats, stats->rules[SubtypeStats::AS_Branch]++);
+            auto branch1 = static_cast<graph::Branch*>(n1);
+            auto branch2 = static_cast<graph::Branch*>(n2);
+            if(branch1->participant != branch2->participant) return false;
+            // All branches of branch1 must be matched by branches of branch2
+            size_t j = 0;
+            for(auto &b : branch1->branches) {
+                while(j < branch2->branches.size() && branch2->branches[j].first < b.first) {
+                    j++;
+                    STAT(stats, stats->label_merge_steps++);
+                }
+                STAT(stats, stats->label_merge_steps++);
+                if(j >= branch2->branches.size() || branch2->branches[j].first != b.first) return false;
+                children.push_back({b.second, branch2->branches[j].second});
+            }
+            return true;
+        }
+        case graph::TypeSelect: { // AS-Select
+            STAT(stats, stats->rules[SubtypeStats::AS_Select]++);
+            auto select1 = static_cast<graph::Select*>(n1);
+            auto select2 = static_cast<graph::Select*>(n2);
+            if(select1->participant != select2->participant) return false;
+            // All branches of select2 must be matched by branches of select1
+            size_t j = 0;
+            for(auto &b : select2->branches) {
+                while(j < select1->branches.size() && select1->branches[j].first < b.first) {
+                    j++;
+                    STAT(stats, stats->label_merge_steps++);
+                }
+                STAT(stats, stats->label_merge_steps++);
+                if(j >= select1->branches.size() || select1->branches[j].first != b.first) return false;
+                children.push_back({select1->branches[j].second, b.second});
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+struct StackFrontier {
+    std::vector<NodePair> items;
+
+    void push(const NodePair &p) { items.push_back(p); }
+    NodePair pop() {
+        NodePair p = items.back();
+        items.pop_back();
+        return p;
+    }
+    bool empty() const { return items.empty(); }
+};
+
+struct QueueFrontier {
+    std::deque<NodePair> items;
+
+    void push(const NodePair &p) { items.push_back(p); }
+    NodePair pop() {
+        NodePair p = items.front();
+        items.pop_front();
+        return p;
+    }
+    bool empty() const { return items.empty(); }
+};
+
+// Lowest pair height first, where a pair is as high as its lower node.
+// Heights are bounded by the type sizes, so the pairs are kept in one bucket
+// per height; a pair's children are at most one lower than the pair itself.
+struct HeightFrontier {
+    std::unordered_map<Node*, unsigned> height;
+    std::vector<std::vector<NodePair>> buckets;
+    std::size_t lowest = 0;
+    std::size_t count = 0;
+
+    void push(const NodePair &p) {
+        std::size_t h = std::min(height[p.first], height[p.second]);
+        if(h >= buckets.size()) buckets.resize(h + 1);
+        buckets[h].push_back(p);
+        lowest = std::min(lowest, h);
+        count++;
+    }
+    NodePair pop() {
+        while(buckets[lowest].empty()) {
+            lowest++;
+        }
+        NodePair p = buckets[lowest].back();
+        buckets[lowest].pop_back();
+        count--;
+        return p;
+    }
+    bool empty() const { return count == 0; }
+};
+
+// Every pair is put in sigma when it is first reached and visited once. As
+// with check_rule, a pair in sigma is assumed to hold (AS-Assump).
+template <typename Frontier>
+static bool explore(Type &t1, Type &t2, Strategy strategy, Frontier &frontier, const CancelToken &timeout_handler, SubtypeStats *stats) {
+    FlatPairSet sigma;
+    std::vector<NodePair> children, lookahead;
+    std::vector<std::pair<std::size_t, NodePair>> ranked;
+    sigma.insert({t1.root, t2.root});
+    frontier.push({t1.root, t2.root});
+    while(!frontier.empty()) {
+        if(timeout_handler.load(std::memory_order_relaxed)) return false;
+        NodePair pair = frontier.pop();
+        children.clear();
+        if(!expand(pair.first, pair.second, children, stats)) return false;
+
+        if(strategy == Strategy::LabelOrder) {
+            // The stack pops the first label first.
+            std::reverse(children.begin(), children.end());
+        } else if(strategy == Strategy::CheapestFirst) {
+            ranked.clear();
+            for(const NodePair &child : children) {
+                if(sigma.contains(child)) continue;
+                lookahead.clear();
+                if(!expand(child.first, child.second, lookahead, nullptr)) return false;
+                ranked.push_back({lookahead.size(), child});
+            }
+            // Most continuations at the bottom of the stack, fewest on top.
+            std::stable_sort(ranked.begin(), ranked.end(), [](const auto &a, const auto &b) {
+                return a.first > b.first;
+            });
+            children.clear();
+            for(auto &r : ranked) {
+                children.push_back(r.second);
+            }
+        }
+
+        for(const NodePair &child : children) {
+            if(sigma.insert(child)) {
+                STAT(stats, stats->sigma_inserts++; stats->peak_sigma = std::max(stats->peak_sigma, sigma.size()));
+                frontier.push(child);
+            } else {
+                STAT(stats, stats->rules[SubtypeStats::AS_Assump]++);
+            }
+        }
+    }
+    return true;
+}
+
+namespace coinductive_sub {
+    bool subtype(Type &t1, Type &t2, Strategy strategy, const CancelToken &timeout_handler, SubtypeStats *stats) {
+        switch(strategy) {
+            case Strategy::BreadthFirst: {
+                QueueFrontier frontier;
+                return explore(t1, t2, strategy, frontier, timeout_handler, stats);
+            }
+            case Strategy::ShallowestFirst: {
+                HeightFrontier frontier;
+                frontier.height.reserve(t1.nodes.size() + t2.nodes.size());
+                add_heights(t1, frontier.height);
+                if(&t1 != &t2) add_heights(t2, frontier.height);
+                return explore(t1, t2, strategy, frontier, timeout_handler, stats);
+            }
+            case Strategy::LabelOrder:
+            case Strategy::CheapestFirst:
+                break;
+        }
+        StackFrontier frontier;
+        return explore(t1, t2, strategy, frontier, timeout_handler, stats);
+    }
+}
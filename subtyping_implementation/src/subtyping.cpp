@@ -1,10 +1,15 @@
 #include "type.hpp"
 #include "graph.hpp"
 #include "subtyping.hpp"
+#include "stats.hpp"
+#include "memory.hpp"
+#include "pair_set.hpp"
+#include "trace.hpp"
+#include "lazy.hpp"
 
 #include <vector>
 #include <utility>
-#include <unordered_set>
+#include <algorithm>
 
 using Node = graph::GraphNode;
 
@@ -17,181 +22,433 @@ int64_t splitmix64(int64_t state) {
 }
 
 namespace inductive_sub {
-    struct PairHash {
-        std::size_t operator() (const std::pair<Node*, Node*>& p) const {
-            int64_t a = reinterpret_cast<int64_t>(p.first);
-            int64_t b = reinterpret_cast<int64_t>(p.second);
-            return (splitmix64(a) << 32) ^ splitmix64(b);
-        }
+    struct Context {
+        PairSet sigma;
+        const CancelToken &timeout_handler;
+        SubtypeStats *stats;
+        MemoryBudget *budget;
+        trace::Buffer *trace = TRACE_ENABLED ? trace::current : nullptr;
+        int depth = 0;
+
+        Context(const CancelToken &timeout_handler, SubtypeStats *stats, MemoryBudget *budget = nullptr)
+            : sigma(0, PairHash(), std::equal_to<NodePair>(), CountingAllocator<NodePair>(budget)),
+              timeout_handler(timeout_handler), stats(stats), budget(budget) {}
     };
 
-    using PairSet = std::unordered_set<std::pair<Node*, Node*>, PairHash>;
+    void assume(Context &ctx, Node *n1, Node *n2) {
+        ctx.sigma.insert({n1, n2});
+        STAT(ctx.stats, ctx.stats->sigma_inserts++; ctx.stats->peak_sigma = std::max(ctx.stats->peak_sigma, ctx.sigma.size()));
+    }
+
+    void discharge(Context &ctx, Node *n1, Node *n2) {
+        ctx.sigma.erase({n1, n2});
+        STAT(ctx.stats, ctx.stats->sigma_erases++);
+    }
+
+    template <bool Traced>
+    bool check_rule(Context &ctx, Node *n1, Node *n2, unsigned depth);
 
-    bool check_rule(PairSet &sigma, Node *n1, Node *n2, volatile bool &timeout_handler) {
-        if(timeout_handler) return false;
-        if(sigma.find({n1, n2}) != sigma.end()) { // AS-Assump
+    // Traced is fixed for a whole check, so an untraced check runs without
+    // any tracing branches.
+    template <bool Traced>
+    bool apply_rule(Context &ctx, Node *n1, Node *n2, unsigned depth) {
+        [[maybe_unused]] trace::Buffer *trace = Traced ? ctx.trace : nullptr;
+        if(ctx.timeout_handler.load(std::memory_order_relaxed)) {
+            TRACE(trace, no_rule(n1, n2, depth));
+            return false;
+        }
+        if(ctx.budget) {
+            char marker = 0;
+            ctx.budget->note_stack(&marker);
+        }
+        if(ctx.sigma.find({n1, n2}) != ctx.sigma.end()) { // AS-Assump
+            STAT(ctx.stats, ctx.stats->rules[SubtypeStats::AS_Assump]++);
+            TRACE(trace, enter(n1, n2, depth, SubtypeStats::AS_Assump));
             return true;
         }
         if(n1->type() == graph::TypeEnd && n2->type() == graph::TypeEnd) { // AS-End
+            STAT(ctx.stats, ctx.stats->rules[SubtypeStats::AS_End]++);
+            TRACE(trace, enter(n1, n2, depth, SubtypeStats::AS_End));
             return true;
         }
         if(n1->type() == graph::TypeIn && n2->type() == graph::TypeIn) { // AS-In
+            STAT(ctx.stats, ctx.stats->rules[SubtypeStats::AS_In]++);
+            TRACE(trace, enter(n1, n2, depth, SubtypeStats::AS_In));
             auto in1 = static_cast<graph::In*>(n1);
             auto in2 = static_cast<graph::In*>(n2);
-            sigma.insert({n1, n2});
-            bool result = in1->participant == in2->participant && subsort(in2->payload, in1->payload) && check_rule(sigma, in1->continuation, in2->continuation, timeout_handler);
-            sigma.erase({n1, n2});
+            if(in1->participant != in2->participant || !subsort(in2->payload, in1->payload)) {
+                TRACE(trace, fail(depth));
+                return false;
+            }
+            assume(ctx, n1, n2);
+            bool result = check_rule<Traced>(ctx, in1->continuation, in2->continuation, depth + 1);
+            discharge(ctx, n1, n2);
             return result;
         }
         if(n1->type() == graph::TypeOut && n2->type() == graph::TypeOut) { // AS-Out
+            STAT(ctx.stats, ctx.stats->rules[SubtypeStats::AS_Out]++);
+            TRACE(trace, enter(n1, n2, depth, SubtypeStats::AS_Out));
             auto out1 = static_cast<graph::Out*>(n1);
             auto out2 = static_cast<graph::Out*>(n2);
-            sigma.insert({n1, n2});
-            bool result = out1->participant == out2->participant && subsort(out1->payload, out2->payload) && check_rule(sigma, out1->continuation, out2->continuation, timeout_handler);
-            sigma.erase({n1, n2});
+            if(out1->participant != out2->participant || !subsort(out1->payload, out2->payload)) {
+                TRACE(trace, fail(depth));
+                return false;
+            }
+            assume(ctx, n1, n2);
+            bool result = check_rule<Traced>(ctx, out1->continuation, out2->continuation, depth + 1);
+            discharge(ctx, n1, n2);
             return result;
         }
         if(n1->type() == graph::TypeBranch && n2->type() == graph::TypeBranch) { // AS-Branch
+            STAT(ctx.stats, ctx.stats->rules[SubtypeStats::AS_Branch]++);
+            TRACE(trace, enter(n1, n2, depth, SubtypeStats::AS_Branch));
             auto branch1 = static_cast<graph::Branch*>(n1);
             auto branch2 = static_cast<graph::Branch*>(n2);
-            if(branch1->participant != branch2->participant) return false;
-            sigma.insert({n1, n2});
+            if(branch1->participant != branch2->participant) {
+                TRACE(trace, fail(depth));
+                return false;
+            }
+            assume(ctx, n1, n2);
             // Check whether all branches of branch1 are matched by branches of branch2
             size_t branch2_ptr = 0;
             for(size_t i = 0; i < branch1->branches.size(); i++) {
                 while(branch2_ptr < branch2->branches.size()
                     && branch2->branches[branch2_ptr].first < branch1->branches[i].first) {
                     branch2_ptr++;
+                    STAT(ctx.stats, ctx.stats->label_merge_steps++);
                 }
+                STAT(ctx.stats, ctx.stats->label_merge_steps++);
                 if(branch2_ptr >= branch2->branches.size()
                     || branch2->branches[branch2_ptr].first != branch1->branches[i].first) { // Not matched
+                    TRACE(trace, fail(depth));
                     return false;
                 }
-                if(!check_rule(sigma, branch1->branches[i].second, branch2->branches[branch2_ptr].second, timeout_handler)) {
+                if(!check_rule<Traced>(ctx, branch1->branches[i].second, branch2->branches[branch2_ptr].second, depth + 1)) {
                     return false;
                 }
             }
-            sigma.erase({n1, n2});
+            discharge(ctx, n1, n2);
             return true;
         }
         if(n1->type() == graph::TypeSelect && n2->type() == graph::TypeSelect) { // AS-Select
+            STAT(ctx.stats, ctx.stats->rules[SubtypeStats::AS_Select]++);
+            TRACE(trace, enter(n1, n2, depth, SubtypeStats::AS_Select));
             auto select1 = static_cast<graph::Select*>(n1);
             auto select2 = static_cast<graph::Select*>(n2);
-            if(select1->participant != select2->participant) return false;
-            sigma.insert({n1, n2});
+            if(select1->participant != select2->participant) {
+                TRACE(trace, fail(depth));
+                return false;
+            }
+            assume(ctx, n1, n2);
             // Check whether all branches of select2 are matched by branches of select1
             size_t select1_ptr = 0;
             for(size_t i = 0; i < select2->branches.size(); i++) {
                 while(select1_ptr < select1->branches.size()
                     && select1->branches[select1_ptr].first < select2->branches[i].first) {
                     select1_ptr++;
+                    STAT(ctx.stats, ctx.stats->label_merge_steps++);
                 }
+                STAT(ctx.stats, ctx.stats->label_merge_steps++);
                 if(select1_ptr >= select1->branches.size()
                     || select1->branches[select1_ptr].first != select2->branches[i].first) { // Not matched
+                    TRACE(trace, fail(depth));
                     return false;
                 }
-                if(!check_rule(sigma, select1->branches[select1_ptr].second, select2->branches[i].second, timeout_handler)) {
+                if(!check_rule<Traced>(ctx, select1->branches[select1_ptr].second, select2->branches[i].second, depth + 1)) {
                     return false;
                 }
             }
-            sigma.erase({n1, n2});
+            discharge(ctx, n1, n2);
             return true;
         }
+        TRACE(trace, no_rule(n1, n2, depth));
         return false;
     }
 
+    template <bool Traced>
+    bool check_rule(Context &ctx, Node *n1, Node *n2, unsigned depth) {
+#if STATS_ENABLED
+        if(ctx.stats) {
+            ctx.stats->max_depth = std::max(ctx.stats->max_depth, ++ctx.depth);
+            bool result = apply_rule<Traced>(ctx, n1, n2, depth);
+            ctx.depth--;
+            return result;
+        }
+#endif
+        return apply_rule<Traced>(ctx, n1, n2, depth);
+    }
 
-    bool subtype(Type &t1, Type &t2, volatile bool &timeout_handler) {
-        PairSet sigma;
-        return check_rule(sigma, t1.root, t2.root, timeout_handler);
+    bool check(Context &ctx, Node *n1, Node *n2) {
+#if TRACE_ENABLED
+        if(ctx.trace) {
+            bool result = check_rule<true>(ctx, n1, n2, 0);
+            ctx.trace->end(result);
+            return result;
+        }
+#endif
+        return check_rule<false>(ctx, n1, n2, 0);
+    }
+
+    bool subtype(Type &t1, Type &t2, const CancelToken &timeout_handler, SubtypeStats *stats) {
+        Context ctx(timeout_handler, stats);
+        return check(ctx, t1.root, t2.root);
+    }
+
+    MemoryCheckResult subtype(Type &t1, Type &t2, const CancelToken &timeout_handler, MemoryBudget &budget, SubtypeStats *stats) {
+        char stack_base = 0;
+        budget.begin_query(&stack_base);
+        size_t type_bytes = type_footprint(t1) + (&t1 == &t2 ? 0 : type_footprint(t2));
+        MemoryCheckResult result = MemoryCheckResult::OutOfBudget;
+        bool charged = false;
+        try {
+            budget.charge(type_bytes);
+            charged = true;
+            {
+                Context ctx(timeout_handler, stats, &budget);
+                result = check(ctx, t1.root, t2.root) ? MemoryCheckResult::Subtype : MemoryCheckResult::NotSubtype;
+            }
+        } catch(const MemoryBudgetExceeded&) {
+            // Unwinding has already returned sigma to the budget.
+        }
+        if(charged) budget.release(type_bytes);
+        budget.end_query();
+        return result;
     }
 }
 
 
 namespace coinductive_sub {
-    struct PairHash {
-        std::size_t operator() (const std::pair<Node*, Node*>& p) const {
-            int64_t a = reinterpret_cast<int64_t>(p.first);
-            int64_t b = reinterpret_cast<int64_t>(p.second);
-            return (splitmix64(a) << 32) ^ splitmix64(b);
-        }
+    struct Context {
+        PairSet sigma;
+        const CancelToken &timeout_handler;
+        SubtypeStats *stats;
+        MemoryBudget *budget;
+        KnownPairs *known = nullptr;
+        LazyType *lazy1 = nullptr, *lazy2 = nullptr; // set together, see expand()
+        std::vector<NodePair> refuted; // failing path, innermost pair first
+        trace::Buffer *trace = TRACE_ENABLED ? trace::current : nullptr;
+        int depth = 0;
+
+        Context(const CancelToken &timeout_handler, SubtypeStats *stats, MemoryBudget *budget = nullptr)
+            : sigma(0, PairHash(), std::equal_to<NodePair>(), CountingAllocator<NodePair>(budget)),
+              timeout_handler(timeout_handler), stats(stats), budget(budget) {}
     };
 
-    using PairSet = std::unordered_set<std::pair<Node*, Node*>, PairHash>;
+    void assume(Context &ctx, Node *n1, Node *n2) {
+        ctx.sigma.insert({n1, n2});
+        STAT(ctx.stats, ctx.stats->sigma_inserts++; ctx.stats->peak_sigma = std::max(ctx.stats->peak_sigma, ctx.sigma.size()));
+    }
+
+    template <bool Traced>
+    bool check_rule(Context &ctx, Node *n1, Node *n2, unsigned depth);
+
+    // Lazily lowered types get their continuations when a rule first needs them.
+    template <typename T>
+    void expand(Context &ctx, T *n1, T *n2) {
+        if(ctx.lazy1) {
+            ctx.lazy1->expand(n1);
+            ctx.lazy2->expand(n2);
+        }
+    }
 
-    bool check_rule(PairSet &sigma, Node *n1, Node *n2, volatile bool &timeout_handler) {
-        if(timeout_handler) return false;
-        if(sigma.find({n1, n2}) != sigma.end()) { // AS-Assump
+    // Traced is fixed for a whole check, so an untraced check runs without
+    // any tracing branches.
+    template <bool Traced>
+    bool apply_rule(Context &ctx, Node *n1, Node *n2, unsigned depth) {
+        [[maybe_unused]] trace::Buffer *trace = Traced ? ctx.trace : nullptr;
+        if(ctx.timeout_handler.load(std::memory_order_relaxed)) {
+            TRACE(trace, no_rule(n1, n2, depth));
+            return false;
+        }
+        if(ctx.budget) {
+            char marker = 0;
+            ctx.budget->note_stack(&marker);
+        }
+        if(ctx.sigma.find({n1, n2}) != ctx.sigma.end()) { // AS-Assump
+            STAT(ctx.stats, ctx.stats->rules[SubtypeStats::AS_Assump]++);
+            TRACE(trace, enter(n1, n2, depth, SubtypeStats::AS_Assump));
             return true;
         }
+        if(ctx.known) {
+            if(ctx.known->holds.count({n1, n2})) {
+                STAT(ctx.stats, ctx.stats->rules[SubtypeStats::AS_Assump]++);
+                TRACE(trace, enter(n1, n2, depth, SubtypeStats::AS_Assump));
+                return true;
+            }
+            if(ctx.known->fails.count({n1, n2})) {
+                TRACE(trace, no_rule(n1, n2, depth));
+                return false;
+            }
+        }
         if(n1->type() == graph::TypeEnd && n2->type() == graph::TypeEnd) { // AS-End
+            STAT(ctx.stats, ctx.stats->rules[SubtypeStats::AS_End]++);
+            TRACE(trace, enter(n1, n2, depth, SubtypeStats::AS_End));
             return true;
         }
         if(n1->type() == graph::TypeIn && n2->type() == graph::TypeIn) { // AS-In
+            STAT(ctx.stats, ctx.stats->rules[SubtypeStats::AS_In]++);
+            TRACE(trace, enter(n1, n2, depth, SubtypeStats::AS_In));
             auto in1 = static_cast<graph::In*>(n1);
             auto in2 = static_cast<graph::In*>(n2);
-            sigma.insert({n1, n2});
-            bool result = in1->participant == in2->participant && subsort(in2->payload, in1->payload) && check_rule(sigma, in1->continuation, in2->continuation, timeout_handler);
-            return result;
+            if(in1->participant != in2->participant || !subsort(in2->payload, in1->payload)) {
+                TRACE(trace, fail(depth));
+                return false;
+            }
+            expand(ctx, in1, in2);
+            assume(ctx, n1, n2);
+            return check_rule<Traced>(ctx, in1->continuation, in2->continuation, depth + 1);
         }
         if(n1->type() == graph::TypeOut && n2->type() == graph::TypeOut) { // AS-Out
+            STAT(ctx.stats, ctx.stats->rules[SubtypeStats::AS_Out]++);
+            TRACE(trace, enter(n1, n2, depth, SubtypeStats::AS_Out));
             auto out1 = static_cast<graph::Out*>(n1);
             auto out2 = static_cast<graph::Out*>(n2);
-            sigma.insert({n1, n2});
-            bool result = out1->participant == out2->participant && subsort(out1->payload, out2->payload) && check_rule(sigma, out1->continuation, out2->continuation, timeout_handler);
-            return result;
+            if(out1->participant != out2->participant || !subsort(out1->payload, out2->payload)) {
+                TRACE(trace, fail(depth));
+                return false;
+            }
+            expand(ctx, out1, out2);
+            assume(ctx, n1, n2);
+            return check_rule<Traced>(ctx, out1->continuation, out2->continuation, depth + 1);
         }
         if(n1->type() == graph::TypeBranch && n2->type() == graph::TypeBranch) { // AS-Branch
+            STAT(ctx.stats, ctx.stats->rules[SubtypeStats::AS_Branch]++);
+            TRACE(trace, enter(n1, n2, depth, SubtypeStats::AS_Branch));
             auto branch1 = static_cast<graph::Branch*>(n1);
             auto branch2 = static_cast<graph::Branch*>(n2);
-            if(branch1->participant != branch2->participant) return false;
-            sigma.insert({n1, n2});
+            if(branch1->participant != branch2->participant) {
+                TRACE(trace, fail(depth));
+                return false;
+            }
+            expand(ctx, branch1, branch2);
+            assume(ctx, n1, n2);
             // Check whether all branches of branch1 are matched by branches of branch2
             size_t branch2_ptr = 0;
             for(size_t i = 0; i < branch1->branches.size(); i++) {
                 while(branch2_ptr < branch2->branches.size()
                     && branch2->branches[branch2_ptr].first < branch1->branches[i].first) {
                     branch2_ptr++;
+                    STAT(ctx.stats, ctx.stats->label_merge_steps++);
                 }
+                STAT(ctx.stats, ctx.stats->label_merge_steps++);
                 if(branch2_ptr >= branch2->branches.size()
                     || branch2->branches[branch2_ptr].first != branch1->branches[i].first) { // Not matched
+                    TRACE(trace, fail(depth));
                     return false;
                 }
-                if(!check_rule(sigma, branch1->branches[i].second, branch2->branches[branch2_ptr].second, timeout_handler)) {
+                if(!check_rule<Traced>(ctx, branch1->branches[i].second, branch2->branches[branch2_ptr].second, depth + 1)) {
                     return false;
                 }
             }
             return true;
         }
         if(n1->type() == graph::TypeSelect && n2->type() == graph::TypeSelect) { // AS-Select
+            STAT(ctx.stats, ctx.stats->rules[SubtypeStats::AS_Select]++);
+            TRACE(trace, enter(n1, n2, depth, SubtypeStats::AS_Select));
             auto select1 = static_cast<graph::Select*>(n1);
             auto select2 = static_cast<graph::Select*>(n2);
-            if(select1->participant != select2->participant) return false;
-            sigma.insert({n1, n2});
+            if(select1->participant != select2->participant) {
+                TRACE(trace, fail(depth));
+                return false;
+            }
+            expand(ctx, select1, select2);
+            assume(ctx, n1, n2);
             // Check whether all branches of select2 are matched by branches of select1
             size_t select1_ptr = 0;
             for(size_t i = 0; i < select2->branches.size(); i++) {
                 while(select1_ptr < select1->branches.size()
                     && select1->branches[select1_ptr].first < select2->branches[i].first) {
                     select1_ptr++;
+                    STAT(ctx.stats, ctx.stats->label_merge_steps++);
                 }
+                STAT(ctx.stats, ctx.stats->label_merge_steps++);
                 if(select1_ptr >= select1->branches.size()
                     || select1->branches[select1_ptr].first != select2->branches[i].first) { // Not matched
+                    TRACE(trace, fail(depth));
                     return false;
                 }
-                if(!check_rule(sigma, select1->branches[select1_ptr].second, select2->branches[i].second, timeout_handler)) {
+                if(!check_rule<Traced>(ctx, select1->branches[select1_ptr].second, select2->branches[i].second, depth + 1)) {
                     return false;
                 }
             }
             return true;
         }
+        TRACE(trace, no_rule(n1, n2, depth));
         return false;
     }
 
+    template <bool Traced>
+    bool check_rule(Context &ctx, Node *n1, Node *n2, unsigned depth) {
+#if STATS_ENABLED
+        if(ctx.stats) {
+            ctx.stats->max_depth = std::max(ctx.stats->max_depth, ++ctx.depth);
+            bool result = apply_rule<Traced>(ctx, n1, n2, depth);
+            ctx.depth--;
+            if(!result && ctx.known) ctx.refuted.push_back({n1, n2});
+            return result;
+        }
+#endif
+        bool result = apply_rule<Traced>(ctx, n1, n2, depth);
+        // Every rule needs all of its children, so a failure refutes each
+        // pair on the way back up.
+        if(!result && ctx.known) ctx.refuted.push_back({n1, n2});
+        return result;
+    }
 
-    bool subtype(Type &t1, Type &t2, volatile bool &timeout_handler) {
-        PairSet sigma;
-        return check_rule(sigma, t1.root, t2.root, timeout_handler);
+    bool check(Context &ctx, Node *n1, Node *n2) {
+#if TRACE_ENABLED
+        if(ctx.trace) {
+            bool result = check_rule<true>(ctx, n1, n2, 0);
+            ctx.trace->end(result);
+            return result;
+        }
+#endif
+        return check_rule<false>(ctx, n1, n2, 0);
     }
-}
 
+    bool subtype(Type &t1, Type &t2, const CancelToken &timeout_handler, SubtypeStats *stats) {
+        Context ctx(timeout_handler, stats);
+        return check(ctx, t1.root, t2.root);
+    }
+
+    MemoryCheckResult subtype(Type &t1, Type &t2, const CancelToken &timeout_handler, MemoryBudget &budget, SubtypeStats *stats) {
+        char stack_base = 0;
+        budget.begin_query(&stack_base);
+        size_t type_bytes = type_footprint(t1) + (&t1 == &t2 ? 0 : type_footprint(t2));
+        MemoryCheckResult result = MemoryCheckResult::OutOfBudget;
+        bool charged = false;
+        try {
+            budget.charge(type_bytes);
+            charged = true;
+            {
+                Context ctx(timeout_handler, stats, &budget);
+                result = check(ctx, t1.root, t2.root) ? MemoryCheckResult::Subtype : MemoryCheckResult::NotSubtype;
+            }
+        } catch(const MemoryBudgetExceeded&) {
+            // Unwinding has already returned sigma to the budget.
+        }
+        if(charged) budget.release(type_bytes);
+        budget.end_query();
+        return result;
+    }
+
+    bool subtype(Type &t1, Type &t2, const CancelToken &timeout_handler, KnownPairs &known, SubtypeStats *stats) {
+        Context ctx(timeout_handler, stats);
+        ctx.known = &known;
+        bool result = check(ctx, t1.root, t2.root);
+        if(timeout_handler.load(std::memory_order_relaxed)) return result;
+        if(result) {
+            known.holds.insert(ctx.sigma.begin(), ctx.sigma.end());
+        } else {
+            known.fails.insert(ctx.refuted.begin(), ctx.refuted.end());
+        }
+        return result;
+    }
+
+    bool subtype(LazyType &t1, LazyType &t2, const CancelToken &timeout_handler, SubtypeStats *stats) {
+        Context ctx(timeout_handler, stats);
+        ctx.lazy1 = &t1;
+        ctx.lazy2 = &t2;
+        return check(ctx, t1.type().root, t2.type().root);
+    }
+}
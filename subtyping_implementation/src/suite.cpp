@@ -0,0 +1,293 @@
+#include "suite.hpp"
+#include "type.hpp"
+#include "type_generator.hpp"
+#include "unfold.hpp"
+#include "hard_instances.hpp"
+#include "batch.hpp"
+#include "subtyping.hpp"
+#include "compact.hpp"
+#include "result_cache.hpp"
+#include "trace.hpp"
+#include "graph.hpp"
+
+#include <random>
+#include <fstream>
+#include <thread>
+#include <ctime>
+#include <memory>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/utsname.h>
+#include <unistd.h>
+#endif
+
+#ifndef BUILD_FLAGS
+#define BUILD_FLAGS "unknown"
+#endif
+
+std::vector<const Engine*> selected_engines(const SuiteOptions &options) {
+    std::vector<const Engine*> result;
+    for(const Engine &engine : engines()) {
+        bool selected = options.engines.empty() && !engine.cross_check_only;
+        for(const std::string &name : options.engines) {
+            selected = selected || name == engine.name;
+        }
+        if(selected) result.push_back(&engine);
+    }
+    return result;
+}
+
+// Each k gets its own stream so that a sub-range reproduces the full run.
+static std::mt19937 rng_for(const SuiteOptions &options, int k) {
+    std::seed_seq seq{options.seed, static_cast<unsigned>(k)};
+    return std::mt19937(seq);
+}
+
+static BenchmarkRunner::Job repeat(const Engine &engine, Type &t1, Type &t2, int iterations) {
+    return [&engine, &t1, &t2, iterations](const CancelToken &h, SubtypeStats *s) {
+        volatile int x = 0;
+        for(int i = 0; i < iterations; i++) {
+            x += engine.subtype(t1, t2, h, s);
+        }
+        return x;
+    };
+}
+
+static void measure_all(BenchmarkRunner &runner, const SuiteOptions &options, ResultWriter &out, int k, Type &t1, Type &t2) {
+    for(const Engine *engine : selected_engines(options)) {
+        out.write(engine->name, k, runner.measure(repeat(*engine, t1, t2, options.iterations), options.config));
+    }
+}
+
+// The same calls through a ResultCache that lives for the whole measurement,
+// as for a caller that re-checks hot pairs. Written as the row
+// "coinductive-cached" whenever the coinductive engine is selected.
+static void measure_cached(BenchmarkRunner &runner, const SuiteOptions &options, ResultWriter &out, int k, Type &t1, Type &t2) {
+    if(!options.engines.empty() && std::find(options.engines.begin(), options.engines.end(), "coinductive") == options.engines.end()) return;
+    ResultCache cache;
+    int iterations = options.iterations;
+    out.write("coinductive-cached", k, runner.measure([&cache, &t1, &t2, iterations](const CancelToken &h, SubtypeStats *s) {
+        volatile int x = 0;
+        for(int i = 0; i < iterations; i++) {
+            x += cache.subtype(t1, t2, h, s);
+        }
+        return x;
+    }, options.config));
+}
+
+static void run_worst_case(BenchmarkRunner &runner, const SuiteOptions &options, ResultWriter &out) {
+    for(int k = options.size_min; k <= options.size_max; k += options.size_step) {
+        Type t1 = generate_exponential_counterexample(k);
+        Type t2 = generate_exponential_counterexample(k+1);
+        measure_all(runner, options, out, k, t1, t2);
+    }
+}
+
+static void run_isomorphic(BenchmarkRunner &runner, const SuiteOptions &options, ResultWriter &out) {
+    for(int k = options.size_min; k <= options.size_max; k += options.size_step) {
+        std::mt19937 rng = rng_for(options, k);
+        Type t1 = generate_random_isomorphic_type(k, rng);
+        Type t2 = generate_random_isomorphic_type(k, rng);
+        measure_all(runner, options, out, k, t1, t2);
+    }
+}
+
+static void run_idempotent(BenchmarkRunner &runner, const SuiteOptions &options, ResultWriter &out) {
+    for(int k = options.size_min; k <= options.size_max; k += options.size_step) {
+        std::mt19937 rng = rng_for(options, k);
+        Type t1 = generate_random_type(options.type_size, 4, rng, true, 2);
+        measure_all(runner, options, out, k, t1, t1);
+        measure_cached(runner, options, out, k, t1, t1);
+    }
+}
+
+static void run_unfolded(BenchmarkRunner &runner, const SuiteOptions &options, ResultWriter &out) {
+    for(int k = options.size_min; k <= options.size_max; k += options.size_step) {
+        std::mt19937 rng = rng_for(options, k);
+        Type t1, t2;
+        do {
+            t1 = generate_random_type(options.type_size, 4, rng, true, 2);
+            t2 = unfold_once(t1);
+        } while (t2.nodes.size() == t1.nodes.size());
+        measure_all(runner, options, out, k, t1, t2);
+        measure_cached(runner, options, out, k, t1, t2);
+    }
+}
+
+// A different participant at one reachable node of t, which every check of
+// t against the result must reach and refute.
+static Type with_fault(const Type &t, std::mt19937 &rng) {
+    Type result = t;
+    std::vector<graph::GraphNode*> candidates;
+    for(graph::GraphNode *node : result.nodes) {
+        if(node->type() != graph::TypeEnd) candidates.push_back(node);
+    }
+    if(candidates.empty()) return result;
+    graph::GraphNode *node = candidates[rng() % candidates.size()];
+    switch(node->type()) {
+        case graph::TypeIn: static_cast<graph::In*>(node)->participant++; break;
+        case graph::TypeOut: static_cast<graph::Out*>(node)->participant++; break;
+        case graph::TypeBranch: static_cast<graph::Branch*>(node)->participant++; break;
+        case graph::TypeSelect: static_cast<graph::Select*>(node)->participant++; break;
+        case graph::TypeEnd: break;
+    }
+    return result;
+}
+
+static void run_refutation(BenchmarkRunner &runner, const SuiteOptions &options, ResultWriter &out) {
+    for(int k = options.size_min; k <= options.size_max; k += options.size_step) {
+        std::mt19937 rng = rng_for(options, k);
+        Type t1 = generate_random_type(options.type_size, 4, rng, true, 2);
+        compact(t1); // so that the fault is reachable
+        Type t2 = with_fault(t1, rng);
+        measure_all(runner, options, out, k, t1, t2);
+    }
+}
+
+// k is the interleaving width. The same batch of large random types, each
+// against a copy of itself, is also run query by query on the recursive
+// engine for comparison.
+static void run_batch(BenchmarkRunner &runner, const SuiteOptions &options, ResultWriter &out) {
+    std::vector<std::unique_ptr<Type>> types;
+    std::vector<Query> queries;
+    for(int i = 0; i < options.iterations; i++) {
+        types.push_back(std::make_unique<Type>(generate_large_random_type(options.type_size, 4, rng_for(options, i)(), 1)));
+        types.push_back(std::make_unique<Type>(*types.back()));
+        queries.push_back({types[2 * i].get(), types[2 * i + 1].get()});
+    }
+    for(int k = options.size_min; k <= options.size_max; k += options.size_step) {
+        out.write("sequential", k, runner.measure([&queries](const CancelToken &h, SubtypeStats*) {
+            volatile int x = 0;
+            for(const Query &query : queries) {
+                x += coinductive_sub::subtype(*query.first, *query.second, h);
+            }
+            return x;
+        }, options.config));
+        out.write("interleaved", k, runner.measure([&queries, k](const CancelToken &h, SubtypeStats*) {
+            volatile int x = 0;
+            for(Verdict verdict : subtype_batch(queries, false, k, &h)) {
+                x += verdict == Verdict::Yes;
+            }
+            return x;
+        }, options.config));
+    }
+}
+
+// Past the family's recursive_max the recursive engines would overflow the
+// worker's stack, so they get a failed row instead of a run.
+static void run_hard(const HardFamily &family, BenchmarkRunner &runner, const SuiteOptions &options, ResultWriter &out) {
+    for(int k = options.size_min; k <= options.size_max; k += options.size_step) {
+        HardInstance instance = family.make(k);
+        for(const Engine *engine : selected_engines(options)) {
+            if(engine->recursive && family.recursive_max > 0 && k > family.recursive_max) {
+                Measurement too_deep;
+                too_deep.success = false;
+                out.write(engine->name, k, too_deep);
+                continue;
+            }
+            out.write(engine->name, k, runner.measure(repeat(*engine, instance.sub, instance.super, options.iterations), options.config));
+        }
+    }
+}
+
+static SuiteOptions make_defaults(int size_min, int size_max, int type_size, int iterations) {
+    SuiteOptions options;
+    options.size_min = size_min;
+    options.size_max = size_max;
+    options.type_size = type_size;
+    options.iterations = iterations;
+    return options;
+}
+
+const std::vector<Suite>& benchmark_suites() {
+    static const std::vector<Suite> suites = [] {
+        std::vector<Suite> suites = {
+        {"worst-case", "exponential counterexample, k vs k+1", make_defaults(1, 10, 0, 1), run_worst_case},
+        {"isomorphic", "two random unfoldings of the binary branch loop with k nodes", make_defaults(1, 100, 0, 1), run_isomorphic},
+        {"idempotent", "random type checked against itself, k is the sample index", make_defaults(0, 99, 10000, 10000), run_idempotent},
+        {"unfolded", "random type against its one-step unfolding, k is the sample index", make_defaults(0, 99, 1000, 10000), run_unfolded},
+        {"refutation", "random type against a copy with one wrong participant, k is the sample index", make_defaults(0, 99, 10000, 100), run_refutation},
+        {"batch", "batch of type_size-node checks, sequential vs interleaved k at a time", make_defaults(1, 8, 20000, 64), run_batch},
+        };
+        for(const HardFamily &family : hard_families()) {
+            const HardFamily *f = &family;
+            suites.push_back({"hard-" + family.name, family.description, make_defaults(1, family.default_max, 0, 1),
+                [f](BenchmarkRunner &runner, const SuiteOptions &options, ResultWriter &out) {
+                    run_hard(*f, runner, options, out);
+                }});
+        }
+        return suites;
+    }();
+    return suites;
+}
+
+const Suite* find_suite(const std::string &name) {
+    for(const Suite &suite : benchmark_suites()) {
+        if(suite.name == name) return &suite;
+    }
+    return nullptr;
+}
+
+std::string result_file_name(const Suite &suite, ResultWriter::Format format) {
+    std::string name = "results_" + suite.name;
+    for(char &c : name) {
+        if(c == '-') c = '_';
+    }
+    return name + (format == ResultWriter::JSON ? ".json" : ".txt");
+}
+
+static std::string cpu_model() {
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while(std::getline(cpuinfo, line)) {
+        if(line.rfind("model name", 0) == 0) {
+            return line.substr(line.find(':') + 2);
+        }
+    }
+    return "unknown";
+}
+
+std::vector<std::pair<std::string, std::string>> run_metadata(const Suite &suite, const SuiteOptions &options) {
+    std::string engine_names;
+    for(const Engine *engine : selected_engines(options)) {
+        engine_names += (engine_names.empty() ? "" : " ") + engine->name;
+    }
+
+    char timestamp[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    std::string host = "unknown", os = "unknown";
+#ifdef __linux__
+    utsname uts;
+    if(uname(&uts) == 0) {
+        host = uts.nodename;
+        os = std::string(uts.sysname) + " " + uts.release + " " + uts.machine;
+    }
+#endif
+
+    return {
+        {"suite", suite.name},
+        {"description", suite.description},
+        {"size_min", std::to_string(options.size_min)},
+        {"size_max", std::to_string(options.size_max)},
+        {"size_step", std::to_string(options.size_step)},
+        {"type_size", std::to_string(options.type_size)},
+        {"iterations", std::to_string(options.iterations)},
+        {"seed", std::to_string(options.seed)},
+        {"engines", engine_names},
+        {"warmup", std::to_string(options.config.warmup)},
+        {"trials", std::to_string(options.config.trials)},
+        {"timeout_ns", std::to_string(options.config.timeout)},
+        {"compiler", __VERSION__},
+        {"build_flags", BUILD_FLAGS},
+        {"stats", STATS_ENABLED ? "on" : "off"},
+        {"trace", TRACE_ENABLED ? "on" : "off"},
+        {"host", host},
+        {"os", os},
+        {"cpu", cpu_model()},
+        {"hardware_threads", std::to_string(std::thread::hardware_concurrency())},
+        {"timestamp", timestamp},
+    };
+}
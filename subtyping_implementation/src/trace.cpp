@@ -0,0 +1,118 @@
+#include "trace.hpp"
+#include "stats.hpp"
+
+#include <mutex>
+#include <memory>
+#include <cstdio>
+#include <algorithm>
+
+namespace trace {
+    thread_local Buffer *current = nullptr;
+
+    // Buffers are only shared once their thread has stopped recording.
+    static std::mutex stopped_mutex;
+    static std::vector<std::unique_ptr<Buffer>> stopped;
+    static unsigned next_thread_id = 0;
+
+    Buffer::Buffer(std::size_t capacity, unsigned thread_id) : thread_id(thread_id) {
+        std::size_t size = STAMP_INTERVAL;
+        while(size < capacity) size *= 2;
+        events.resize(size);
+        stamps.resize(size / STAMP_INTERVAL);
+        mask = size - 1;
+        start_time = std::chrono::steady_clock::now();
+        start_ticks = ticks();
+    }
+
+    void start(std::size_t capacity) {
+        if(current) stop();
+        unsigned id;
+        {
+            std::lock_guard<std::mutex> lock(stopped_mutex);
+            id = next_thread_id++;
+        }
+        current = new Buffer(capacity, id);
+    }
+
+    void stop() {
+        if(!current) return;
+        current->stop_ticks = Buffer::ticks();
+        current->stop_time = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(stopped_mutex);
+        stopped.emplace_back(current);
+        current = nullptr;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(stopped_mutex);
+        stopped.clear();
+    }
+
+    static const char *RULE_NAMES[SubtypeStats::NUM_RULES] = {
+        "AS-In", "AS-Out", "AS-Branch", "AS-Select", "AS-Assump", "AS-End",
+    };
+
+    // Events are exported from the oldest one whose stamp survives in the
+    // ring. A pair that is open when an event at its depth or above comes
+    // ends there, successfully unless that event is its failure, which also
+    // fails every pair it is nested in; pairs still open at the end of the
+    // ring end at the stop time.
+    void write_chrome_json(std::ostream &out) {
+        std::lock_guard<std::mutex> lock(stopped_mutex);
+        std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::time_point::max();
+        for(auto &buffer : stopped) {
+            origin = std::min(origin, buffer->start_time);
+        }
+
+        out << "{\"traceEvents\":[";
+        bool first = true;
+        char line[256];
+        auto emit = [&] {
+            out << (first ? "\n" : ",\n") << line;
+            first = false;
+        };
+        for(auto &buffer : stopped) {
+            double elapsed = std::chrono::duration<double, std::micro>(buffer->stop_time - buffer->start_time).count();
+            double us_per_tick = buffer->stop_ticks > buffer->start_ticks ? elapsed / (buffer->stop_ticks - buffer->start_ticks) : 0;
+            double offset = std::chrono::duration<double, std::micro>(buffer->start_time - origin).count();
+
+            std::vector<unsigned> open; // depths of the pairs begun but not ended
+            auto end_from = [&](unsigned depth, double ts, bool result) {
+                while(!open.empty() && open.back() >= depth) {
+                    std::snprintf(line, sizeof(line), "{\"ph\":\"E\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"result\":%s}}",
+                        ts, buffer->thread_id, result ? "true" : "false");
+                    emit();
+                    open.pop_back();
+                }
+            };
+
+            uint64_t begin = buffer->next > buffer->events.size() ? buffer->next - buffer->events.size() : 0;
+            begin = (begin + STAMP_INTERVAL - 1) / STAMP_INTERVAL * STAMP_INTERVAL;
+            for(uint64_t i = begin; i < buffer->next; i++) {
+                const Event &e = buffer->events[i & buffer->mask];
+                // Linear between this event's stamp and the next one (or the stop time).
+                uint64_t stamped = i - i % STAMP_INTERVAL, following = stamped + STAMP_INTERVAL;
+                uint64_t from = buffer->stamps[(stamped & buffer->mask) / STAMP_INTERVAL];
+                uint64_t to = following < buffer->next ? buffer->stamps[(following & buffer->mask) / STAMP_INTERVAL] : buffer->stop_ticks;
+                uint64_t span = std::min(following, buffer->next) - stamped;
+                double elapsed_ticks = from - buffer->start_ticks + double(to - from) * (i - stamped) / span;
+                double ts = offset + elapsed_ticks * us_per_tick;
+                if(e.exit()) {
+                    end_from(e.depth() + 1, ts, true);
+                    end_from(e.result() ? e.depth() : 0, ts, e.result());
+                } else {
+                    end_from(e.depth(), ts, true);
+                    const char *name = e.rule() >= 0 ? RULE_NAMES[e.rule()] : "no rule";
+                    std::snprintf(line, sizeof(line),
+                        "{\"name\":\"%s\",\"cat\":\"subtype\",\"ph\":\"B\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,"
+                        "\"args\":{\"pair\":\"%p:%p\",\"depth\":%u}}",
+                        name, ts, buffer->thread_id, static_cast<void*>(e.n1()), static_cast<void*>(e.n2()), e.depth());
+                    emit();
+                    open.push_back(e.depth());
+                }
+            }
+            end_from(0, offset + (buffer->stop_ticks - buffer->start_ticks) * us_per_tick, true);
+        }
+        out << "\n]}\n";
+    }
+}
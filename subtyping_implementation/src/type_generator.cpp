@@ -1,7 +1,9 @@
 #include <random>
 #include <vector>
-#include <set>
 #include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cstdint>
 #include "assert.h"
 
 #include "graph.hpp"
@@ -20,17 +22,17 @@ Sort random_sort(std::mt19937 &rng) {
     assert(false); // unreachable
 }
 
-// Sample size integers, from [lo, hi)
-std::vector<int> sample_from_range(std::mt19937 rng, int size, int lo, int hi) {
+// Sample size distinct integers from [lo, hi), using Floyd's algorithm so that
+// exactly size draws are made. The order of the result is not uniform.
+std::vector<int> sample_from_range(std::mt19937 &rng, int size, int lo, int hi) {
     std::vector<int> result;
-    std::set<int> used;
-    for(int i = 0; i < size; i++) {
-        int sample;
-        do {
-            sample = rng() % (hi - lo) + lo;
-        } while(used.count(sample) > 0);
+    int n = hi - lo;
+    for(int j = n - size; j < n; j++) {
+        int sample = rng() % (j + 1) + lo;
+        if(std::find(result.begin(), result.end(), sample) != result.end()) {
+            sample = j + lo;
+        }
         result.push_back(sample);
-        used.insert(sample);
     }
     return result;
 }
@@ -75,6 +77,7 @@ graph::GraphNode* gen_into_type(Type &type, int max_size, int branching_factor,
                 type.nodes.push_back(node);
                 int num_branches = rng() % std::min(max_size - 1, branching_factor) + 1;
                 std::vector<int> branch_indices = sample_from_range(rng, num_branches, 0, branching_factor);
+                std::sort(branch_indices.begin(), branch_indices.end()); // branches must be sorted
                 std::vector<int> split_points = sample_from_range(rng, num_branches - 1, 1, max_size - 1);
                 std::sort(split_points.begin(), split_points.end());
                 split_points.insert(split_points.begin(), 0);
@@ -92,6 +95,7 @@ graph::GraphNode* gen_into_type(Type &type, int max_size, int branching_factor,
                 type.nodes.push_back(node);
                 int num_branches = rng() % std::min(max_size - 1, branching_factor) + 1;
                 std::vector<int> branch_indices = sample_from_range(rng, num_branches, 0, branching_factor);
+                std::sort(branch_indices.begin(), branch_indices.end()); // branches must be sorted
                 std::vector<int> split_points = sample_from_range(rng, num_branches - 1, 1, max_size - 1);
                 std::sort(split_points.begin(), split_points.end());
                 split_points.insert(split_points.begin(), 0);
@@ -174,7 +178,8 @@ Type generate_random_isomorphic_type(int nodes, std::mt19937 &rng) {
         type.nodes.push_back(branch);
         int fill_idx = rng() % leaves.size();
         *leaves[fill_idx] = branch;
-        leaves.erase(leaves.begin() + fill_idx);
+        leaves[fill_idx] = leaves.back();
+        leaves.pop_back();
         leaves.push_back(reinterpret_cast<graph::Branch**>(&branch->branches[0].second));
         leaves.push_back(reinterpret_cast<graph::Branch**>(&branch->branches[1].second));
     }
@@ -185,3 +190,153 @@ Type generate_random_isomorphic_type(int nodes, std::mt19937 &rng) {
     }
     return type;
 }
+
+// Large types are generated in chunks of this many nodes. Each chunk has its
+// own RNG stream derived from (seed, chunk index), so the result does not
+// depend on how chunks are spread over threads.
+const size_t LARGE_CHUNK_SIZE = 1 << 16;
+
+struct GeneratedChunk {
+    std::vector<graph::GraphNode*> nodes;
+    graph::GraphNode *root = nullptr;
+    Participant junction_participant = 0;
+};
+
+// Iterative version of gen_into_type: back edges go to ancestors within the chunk.
+void gen_chunk(GeneratedChunk &chunk, int max_size, int branching_factor, uint64_t seed, uint64_t index, bool recursive, int num_participants) {
+    std::seed_seq seq{uint32_t(seed), uint32_t(seed >> 32), uint32_t(index), uint32_t(index >> 32)};
+    std::mt19937 rng(seq);
+
+    struct Task {
+        graph::GraphNode **slot; // nullptr marks leaving the innermost ancestor
+        int size;
+    };
+    std::vector<Task> tasks = {{&chunk.root, max_size}};
+    std::vector<graph::GraphNode*> ancestors;
+
+    auto gen_branches = [&](std::vector<std::pair<graph::Label, graph::GraphNode*>> &branches, int size) {
+        int num_branches = rng() % std::min(size - 1, branching_factor) + 1;
+        std::vector<int> branch_indices = sample_from_range(rng, num_branches, 0, branching_factor);
+        std::sort(branch_indices.begin(), branch_indices.end());
+        std::vector<int> split_points = sample_from_range(rng, num_branches - 1, 1, size - 1);
+        std::sort(split_points.begin(), split_points.end());
+        split_points.insert(split_points.begin(), 0);
+        split_points.push_back(size - 1);
+        branches.resize(num_branches);
+        for(int i = num_branches - 1; i >= 0; i--) {
+            branches[i].first = branch_indices[i];
+            tasks.push_back({&branches[i].second, split_points[i+1] - split_points[i]});
+        }
+    };
+
+    while(!tasks.empty()) {
+        Task task = tasks.back();
+        tasks.pop_back();
+        if(task.slot == nullptr) {
+            ancestors.pop_back();
+            continue;
+        }
+        if(task.size <= 1) {
+            bool gen_end = !recursive || ancestors.empty() || (rng() % 2 == 0);
+            if(gen_end) {
+                graph::End* node = new graph::End();
+                chunk.nodes.push_back(node);
+                *task.slot = node;
+            } else {
+                *task.slot = ancestors[rng() % ancestors.size()];
+            }
+            continue;
+        }
+        graph::GraphNode *node = nullptr;
+        tasks.push_back({nullptr, 0});
+        switch(rng() % 4) {
+            case graph::TypeIn: {
+                graph::In* in = new graph::In(rng() % num_participants);
+                in->payload = random_sort(rng);
+                tasks.push_back({&in->continuation, task.size - 1});
+                node = in;
+                break;
+            }
+            case graph::TypeOut: {
+                graph::Out* out = new graph::Out(rng() % num_participants);
+                out->payload = random_sort(rng);
+                tasks.push_back({&out->continuation, task.size - 1});
+                node = out;
+                break;
+            }
+            case graph::TypeBranch: {
+                graph::Branch* branch = new graph::Branch(rng() % num_participants);
+                gen_branches(branch->branches, task.size);
+                node = branch;
+                break;
+            }
+            case graph::TypeSelect: {
+                graph::Select* select = new graph::Select(rng() % num_participants);
+                gen_branches(select->branches, task.size);
+                node = select;
+                break;
+            }
+        }
+        chunk.nodes.push_back(node);
+        ancestors.push_back(node);
+        *task.slot = node;
+    }
+    chunk.junction_participant = rng() % num_participants;
+}
+
+Type generate_large_random_type(size_t size, int branching_factor, uint64_t seed, int threads, bool recursive, int num_participants) {
+    // A junction needs a label for its own chunk and one for each child, so
+    // with a single label the whole type is one chunk.
+    size_t chunk_limit = branching_factor > 1 ? LARGE_CHUNK_SIZE : std::max<size_t>(size, 1);
+    size_t num_chunks = std::max<size_t>(1, (size + chunk_limit - 1) / chunk_limit);
+    std::vector<GeneratedChunk> chunks(num_chunks);
+    std::atomic<size_t> next_chunk(0);
+    auto worker = [&]() {
+        for(size_t c = next_chunk++; c < num_chunks; c = next_chunk++) {
+            int chunk_size = std::min(chunk_limit, size > c * chunk_limit ? size - c * chunk_limit : 0);
+            gen_chunk(chunks[c], chunk_size, branching_factor, seed, c, recursive, num_participants);
+        }
+    };
+    if(threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> pool;
+    for(int i = 1; i < threads && size_t(i) < num_chunks; i++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for(std::thread &t : pool) {
+        t.join();
+    }
+
+    // Link the chunks as a heap: a junction branch holds chunk c under label 0
+    // and chunks fanout*c+1 .. fanout*c+fanout under labels 1 .. fanout. Like
+    // every other branch, junctions only use labels below branching_factor;
+    // with three or more labels the heap stays binary.
+    size_t fanout = std::min(branching_factor, 3) - 1;
+    Type type;
+    std::vector<graph::GraphNode*> tops(num_chunks);
+    std::vector<graph::GraphNode*> junctions;
+    for(size_t c = num_chunks; c-- > 0; ) {
+        if(fanout*c + 1 >= num_chunks) {
+            tops[c] = chunks[c].root;
+            continue;
+        }
+        graph::Branch* junction = new graph::Branch(chunks[c].junction_participant);
+        junction->branches.push_back({0, chunks[c].root});
+        for(size_t i = 1; i <= fanout && fanout*c + i < num_chunks; i++) {
+            junction->branches.push_back({graph::Label(i), tops[fanout*c + i]});
+        }
+        junctions.push_back(junction);
+        tops[c] = junction;
+    }
+    size_t total = junctions.size();
+    for(GeneratedChunk &chunk : chunks) {
+        total += chunk.nodes.size();
+    }
+    type.nodes.reserve(total);
+    for(GeneratedChunk &chunk : chunks) {
+        type.nodes.insert(type.nodes.end(), chunk.nodes.begin(), chunk.nodes.end());
+    }
+    type.nodes.insert(type.nodes.end(), junctions.rbegin(), junctions.rend());
+    type.root = tops[0];
+    return type;
+}
@@ -0,0 +1,84 @@
+#include "type_hash.hpp"
+#include "pair_set.hpp"
+
+#include <vector>
+
+using namespace graph;
+
+// Finalizer of MurmurHash3, a bijection with good avalanche.
+static uint64_t fmix64(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+static uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+namespace {
+    // Two lanes mixed differently, so the halves of the hash are unrelated.
+    struct Hasher {
+        uint64_t a = 0x243f6a8885a308d3ULL;
+        uint64_t b = 0x13198a2e03707344ULL;
+
+        // One multiply per lane and word; fmix64 at the end spreads the
+        // last words over the whole hash.
+        void add(uint64_t word) {
+            a = rotl(a ^ word, 29) * 0x9e3779b97f4a7c15ULL;
+            b = rotl(b + word, 37) * 0xc2b2ae3d27d4eb4fULL;
+        }
+
+        void add_branches(const std::vector<std::pair<Label, GraphNode*>> &branches, NodeIds &ids, std::vector<GraphNode*> &order) {
+            add(branches.size());
+            for(auto &branch : branches) {
+                add(static_cast<uint64_t>(static_cast<int64_t>(branch.first)));
+                add(ids.number(branch.second, order));
+            }
+        }
+    };
+}
+
+TypeHash canonical_hash(const Type &t) {
+    Hasher h;
+    NodeIds ids;
+    std::vector<GraphNode*> order;
+    ids.reserve(t.nodes.size());
+    order.reserve(t.nodes.size());
+    ids.number(t.root, order);
+    for(std::size_t i = 0; i < order.size(); i++) {
+        GraphNode *node = order[i];
+        h.add(node->type());
+        switch(node->type()) {
+            case TypeIn: {
+                auto in = static_cast<In*>(node);
+                h.add(in->participant);
+                h.add(in->payload);
+                h.add(ids.number(in->continuation, order));
+                break;
+            }
+            case TypeOut: {
+                auto out = static_cast<Out*>(node);
+                h.add(out->participant);
+                h.add(out->payload);
+                h.add(ids.number(out->continuation, order));
+                break;
+            }
+            case TypeBranch:
+                h.add(static_cast<Branch*>(node)->participant);
+                h.add_branches(static_cast<Branch*>(node)->branches, ids, order);
+                break;
+            case TypeSelect:
+                h.add(static_cast<Select*>(node)->participant);
+                h.add_branches(static_cast<Select*>(node)->branches, ids, order);
+                break;
+            case TypeEnd:
+                break;
+        }
+    }
+    h.add(order.size());
+    return {fmix64(h.a), fmix64(h.b ^ h.a)};
+}
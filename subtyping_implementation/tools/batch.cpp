@@ -0,0 +1,186 @@
+// Batch driver. Checks pairs of types (consecutive records of a type stream,
+// see serialize.hpp) or generated pairs with subtype_batch, and reports the
+// throughput next to one-after-another runs of the same queries.
+//
+// usage: batch [FILE|-] [--random N] [--size N] [--seed S] [--width W]
+//              [--inductive] [--compare] [--quiet] [--write FILE] [--no-compact]
+//              [--store FILE]
+//
+// Without a file, --random N pairs (default 64) of a large random type
+// against a copy of itself are checked; --write saves them as a stream.
+// Types are compacted (compact.hpp) before checking unless --no-compact.
+// With --store, verdicts are looked up in and added to a persistent result
+// store (result_store.hpp), so a rerun only checks the pairs it has not seen.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cstdlib>
+
+#include "type.hpp"
+#include "type_generator.hpp"
+#include "subtyping.hpp"
+#include "serialize.hpp"
+#include "batch.hpp"
+#include "compact.hpp"
+#include "result_store.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string input;
+    std::string output;
+    int random = 64;
+    int size = 20000;
+    unsigned seed = 42;
+    int width = 4;
+    bool inductive = false;
+    bool compare = false;
+    bool quiet = false;
+    bool compact = true;
+    std::string store;
+};
+
+const char *USAGE = "usage: batch [FILE|-] [--random N] [--size N] [--seed S] [--width W] [--inductive] [--compare] [--quiet] [--write FILE] [--no-compact] [--store FILE]";
+
+double seconds_since(Clock::time_point begin) {
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(arg == "--random" && i + 1 < argc) {
+            options.random = std::max(1, atoi(argv[++i]));
+        } else if(arg == "--size" && i + 1 < argc) {
+            options.size = std::max(2, atoi(argv[++i]));
+        } else if(arg == "--seed" && i + 1 < argc) {
+            options.seed = std::strtoul(argv[++i], nullptr, 10);
+        } else if(arg == "--width" && i + 1 < argc) {
+            options.width = std::max(1, atoi(argv[++i]));
+        } else if(arg == "--write" && i + 1 < argc) {
+            options.output = argv[++i];
+        } else if(arg == "--inductive") {
+            options.inductive = true;
+        } else if(arg == "--compare") {
+            options.compare = true;
+        } else if(arg == "--quiet") {
+            options.quiet = true;
+        } else if(arg == "--no-compact") {
+            options.compact = false;
+        } else if(arg == "--store" && i + 1 < argc) {
+            options.store = argv[++i];
+        } else if((arg == "-" || arg[0] != '-') && options.input.empty()) {
+            options.input = arg;
+        } else {
+            std::cerr << USAGE << std::endl;
+            return 2;
+        }
+    }
+
+    std::vector<std::unique_ptr<Type>> types;
+    if(!options.input.empty()) {
+        std::ifstream file;
+        if(options.input != "-") {
+            file.open(options.input, std::ios::binary);
+            if(!file) {
+                std::cerr << "cannot open " << options.input << std::endl;
+                return 1;
+            }
+        }
+        std::istream &in = options.input == "-" ? std::cin : file;
+        while(true) {
+            auto t = std::make_unique<Type>();
+            if(!read_type(in, *t)) break;
+            types.push_back(std::move(t));
+        }
+        if(!in.eof()) {
+            std::cerr << "malformed record after " << types.size() << " types" << std::endl;
+            return 1;
+        }
+        if(types.size() % 2 != 0) {
+            std::cerr << "odd number of types; the last one is ignored" << std::endl;
+            types.pop_back();
+        }
+    } else {
+        for(int i = 0; i < options.random; i++) {
+            types.push_back(std::make_unique<Type>(generate_large_random_type(options.size, 4, options.seed + i, 1)));
+            types.push_back(std::make_unique<Type>(*types.back()));
+        }
+    }
+
+    if(!options.output.empty()) {
+        std::ofstream out(options.output, std::ios::binary);
+        for(auto &t : types) {
+            write_type(out, *t);
+        }
+    }
+
+    if(options.compact) {
+        size_t before = 0, after = 0;
+        for(auto &t : types) {
+            CompactionReport report = compact(*t);
+            before += report.nodes_before;
+            after += report.nodes_after;
+        }
+        if(after < before) std::cerr << "compaction dropped " << before - after << " unreachable nodes" << std::endl;
+    }
+
+    std::vector<Query> queries;
+    for(size_t i = 0; i + 1 < types.size(); i += 2) {
+        queries.push_back({types[i].get(), types[i + 1].get()});
+    }
+
+    std::unique_ptr<ResultStore> store;
+    if(!options.store.empty()) {
+        store = std::make_unique<ResultStore>(options.store);
+        if(!store->is_open()) {
+            std::cerr << "cannot open store " << options.store << std::endl;
+            return 1;
+        }
+    }
+
+    Clock::time_point begin = Clock::now();
+    std::vector<Verdict> verdicts = subtype_batch(queries, options.inductive, options.width, nullptr, store.get());
+    double interleaved = seconds_since(begin);
+
+    if(!options.quiet) {
+        for(Verdict verdict : verdicts) {
+            std::cout << (verdict == Verdict::Yes ? "yes" : "no") << "\n";
+        }
+    }
+    std::cerr << queries.size() << " queries, width " << options.width << ": " << interleaved << " s ("
+              << queries.size() / interleaved << " queries/s)" << std::endl;
+    if(store) {
+        std::cerr << "store: " << store->hits() << " hits, " << store->misses() << " checked, " << store->size() << " verdicts ("
+                  << store->loaded() << " loaded)" << std::endl;
+    }
+
+    if(options.compare) {
+        begin = Clock::now();
+        std::vector<Verdict> stepped = subtype_batch(queries, options.inductive, 1);
+        double one_by_one = seconds_since(begin);
+
+        CancelToken token(false);
+        int mismatches = 0;
+        begin = Clock::now();
+        for(size_t i = 0; i < queries.size(); i++) {
+            bool result = options.inductive ? inductive_sub::subtype(*queries[i].first, *queries[i].second, token)
+                                            : coinductive_sub::subtype(*queries[i].first, *queries[i].second, token);
+            mismatches += result != (verdicts[i] == Verdict::Yes) || stepped[i] != verdicts[i];
+        }
+        double recursive = seconds_since(begin);
+
+        std::cerr << "width 1: " << one_by_one << " s, speedup " << one_by_one / interleaved << "x" << std::endl;
+        std::cerr << "recursive engine: " << recursive << " s, speedup " << recursive / interleaved << "x" << std::endl;
+        if(mismatches > 0) {
+            std::cerr << mismatches << " verdicts differ between the runs" << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,217 @@
+// Client for the subtyping server (main --serve). Registers random types and
+// their unfoldings, checks the server's verdicts against a local run, and
+// reports round-trip latency (first query and cached) and pipelined
+// throughput.
+//
+// usage: client SOCKET [--types N] [--size N] [--rounds N] [--depth D] [--seed S]
+//
+// e.g.   bin/main --serve /tmp/subtype.sock &
+//        bin/client /tmp/subtype.sock
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "type.hpp"
+#include "type_generator.hpp"
+#include "unfold.hpp"
+#include "serialize.hpp"
+#include "server.hpp"
+#include "subtyping.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string socket_path;
+    int types = 100;
+    int size = 20;
+    int rounds = 5;
+    int depth = 64;
+    unsigned seed = 42;
+};
+
+class Client {
+    public:
+    explicit Client(int fd) : fd(fd), reader(fd) {}
+    ~Client() { close(fd); }
+
+    // Queues a request; returns its tag.
+    uint32_t send(protocol::Op op, const std::string &payload) {
+        protocol::Frame frame;
+        frame.tag = next_tag++;
+        frame.code = op;
+        frame.payload = payload;
+        protocol::encode(frame, pending);
+        return frame.tag;
+    }
+
+    bool flush() {
+        bool ok = protocol::write_all(fd, pending);
+        pending.clear();
+        return ok;
+    }
+
+    bool receive(protocol::Frame &response) {
+        return reader.next(response);
+    }
+
+    // One request, waiting for its response.
+    bool call(protocol::Op op, const std::string &payload, protocol::Frame &response) {
+        send(op, payload);
+        return flush() && receive(response);
+    }
+
+    private:
+    int fd;
+    protocol::FrameReader reader;
+    std::string pending;
+    uint32_t next_tag = 0;
+};
+
+std::string id_pair(uint64_t id1, uint64_t id2) {
+    std::string payload;
+    protocol::put_id(payload, id1);
+    protocol::put_id(payload, id2);
+    return payload;
+}
+
+void print_latency(const std::string &name, std::vector<double> &samples) {
+    std::sort(samples.begin(), samples.end());
+    std::cout << name << ": p50 " << samples[samples.size() / 2] << " us, p99 "
+              << samples[samples.size() * 99 / 100] << " us over " << samples.size() << " round trips" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(arg == "--types" && i + 1 < argc) {
+            options.types = std::max(1, atoi(argv[++i]));
+        } else if(arg == "--size" && i + 1 < argc) {
+            options.size = std::max(2, atoi(argv[++i]));
+        } else if(arg == "--rounds" && i + 1 < argc) {
+            options.rounds = std::max(1, atoi(argv[++i]));
+        } else if(arg == "--depth" && i + 1 < argc) {
+            options.depth = std::max(1, atoi(argv[++i]));
+        } else if(arg == "--seed" && i + 1 < argc) {
+            options.seed = std::strtoul(argv[++i], nullptr, 10);
+        } else if(arg[0] != '-' && options.socket_path.empty()) {
+            options.socket_path = arg;
+        } else {
+            std::cerr << "usage: client SOCKET [--types N] [--size N] [--rounds N] [--depth D] [--seed S]" << std::endl;
+            return 2;
+        }
+    }
+    if(options.socket_path.empty()) {
+        std::cerr << "usage: client SOCKET [--types N] [--size N] [--rounds N] [--depth D] [--seed S]" << std::endl;
+        return 2;
+    }
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, options.socket_path.c_str(), sizeof(address.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        std::cerr << "cannot connect to " << options.socket_path << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    Client client(fd);
+    protocol::Frame response;
+
+    // Type 2i+1 is the one-step unfolding of type 2i.
+    std::mt19937 rng(options.seed);
+    std::vector<Type> types;
+    std::vector<uint64_t> ids;
+    types.reserve(2 * options.types);
+    for(int i = 0; i < options.types; i++) {
+        types.push_back(generate_random_type(options.size, 3, rng, true, 2));
+        types.push_back(unfold_once(types.back()));
+    }
+    for(Type &t : types) {
+        std::string payload;
+        serialize(t, payload);
+        if(!client.call(protocol::Register, payload, response) || response.code != protocol::Ok) {
+            std::cerr << "register failed" << std::endl;
+            return 1;
+        }
+        uint64_t id;
+        protocol::get_id(response.payload, 0, id);
+        ids.push_back(id);
+    }
+
+    // Queries: every type against its unfolding and against the next type.
+    std::vector<std::pair<int, int>> queries;
+    for(int i = 0; i < options.types; i++) {
+        queries.push_back({2 * i, 2 * i + 1});
+        queries.push_back({2 * i, (2 * i + 2) % types.size()});
+    }
+
+    CancelToken token(false);
+    int mismatches = 0;
+    std::vector<double> first, cached;
+    for(int round = 0; round < options.rounds; round++) {
+        for(auto &query : queries) {
+            Clock::time_point begin = Clock::now();
+            if(!client.call(protocol::Subtype, id_pair(ids[query.first], ids[query.second]), response) || response.code != protocol::Ok) {
+                std::cerr << "subtype request failed" << std::endl;
+                return 1;
+            }
+            double us = std::chrono::duration<double, std::micro>(Clock::now() - begin).count();
+            (round == 0 ? first : cached).push_back(us);
+            if(round == 0) {
+                bool expected = coinductive_sub::subtype(types[query.first], types[query.second], token);
+                mismatches += response.payload[0] != static_cast<char>(expected);
+            }
+        }
+    }
+    print_latency("first query", first);
+    if(!cached.empty()) print_latency("cached", cached);
+
+    if(!client.call(protocol::Equivalent, id_pair(ids[0], ids[1]), response) || response.payload[0] != 1) {
+        std::cerr << "a type and its unfolding should be equivalent" << std::endl;
+        mismatches++;
+    }
+
+    // Pipelined: keep depth requests in flight.
+    size_t total = queries.size() * options.rounds, sent = 0, received = 0;
+    Clock::time_point begin = Clock::now();
+    while(received < total) {
+        while(sent < total && sent - received < static_cast<size_t>(options.depth)) {
+            auto &query = queries[sent % queries.size()];
+            client.send(protocol::Subtype, id_pair(ids[query.first], ids[query.second]));
+            sent++;
+        }
+        if(!client.flush() || !client.receive(response)) {
+            std::cerr << "connection lost" << std::endl;
+            return 1;
+        }
+        received++;
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    std::cout << "pipelined (depth " << options.depth << "): " << total / seconds << " requests/s" << std::endl;
+
+    for(uint64_t id : ids) {
+        std::string payload;
+        protocol::put_id(payload, id);
+        client.send(protocol::Drop, payload);
+    }
+    client.flush();
+    for(size_t i = 0; i < ids.size(); i++) {
+        if(!client.receive(response) || response.code != protocol::Ok) {
+            std::cerr << "drop failed" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << mismatches << " verdicts differ from a local check" << std::endl;
+    return mismatches > 0 ? 1 : 0;
+}
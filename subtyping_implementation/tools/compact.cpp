@@ -0,0 +1,109 @@
+// Effect of compaction (compact.hpp) on node count and traversal time, for
+// types whose arenas carry garbage or have lost their locality.
+//
+// usage: compact [--size N] [--seed S] [--reps N]
+//
+// Each shape is timed as a full traversal: the type checked against itself
+// with the explicit-stack engine, before and after compaction.
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+
+#include "type.hpp"
+#include "type_generator.hpp"
+#include "compact.hpp"
+#include "resumable.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+// Copy of t whose nodes are allocated in a random order, as after many edits.
+Type scattered(const Type &t, std::mt19937 &rng) {
+    Type view;
+    view.root = t.root;
+    view.nodes = t.nodes;
+    std::shuffle(view.nodes.begin(), view.nodes.end(), rng);
+    Type result;
+    copy_into_type(true, result, view);
+    view.nodes.clear(); // owned by t
+    return result;
+}
+
+// Copy of t with one in a hundred nodes sending its first edge back to the
+// root, which leaves part of the arena unreachable.
+Type edited(const Type &t, std::mt19937 &rng) {
+    Type result = t;
+    for(size_t i = 0; i < result.nodes.size() / 100; i++) {
+        graph::GraphNode *node = result.nodes[rng() % result.nodes.size()];
+        switch(node->type()) {
+            case graph::TypeIn:
+                static_cast<graph::In*>(node)->continuation = result.root;
+                break;
+            case graph::TypeOut:
+                static_cast<graph::Out*>(node)->continuation = result.root;
+                break;
+            case graph::TypeBranch:
+                static_cast<graph::Branch*>(node)->branches[0].second = result.root;
+                break;
+            case graph::TypeSelect:
+                static_cast<graph::Select*>(node)->branches[0].second = result.root;
+                break;
+            case graph::TypeEnd:
+                break;
+        }
+    }
+    return result;
+}
+
+// Best of reps full traversals, in seconds.
+double traversal_time(Type &t, int reps) {
+    double best = 1e30;
+    for(int i = 0; i < reps; i++) {
+        Clock::time_point begin = Clock::now();
+        BudgetedResult result = coinductive_sub::subtype(t, t, ~0ull);
+        best = std::min(best, std::chrono::duration<double>(Clock::now() - begin).count());
+        if(result.verdict != Verdict::Yes) std::cerr << "unexpected verdict" << std::endl;
+    }
+    return best;
+}
+
+int main(int argc, char **argv) {
+    int size = 1000000, reps = 3;
+    unsigned seed = 42;
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(arg == "--size" && i + 1 < argc) {
+            size = std::max(2, atoi(argv[++i]));
+        } else if(arg == "--seed" && i + 1 < argc) {
+            seed = std::strtoul(argv[++i], nullptr, 10);
+        } else if(arg == "--reps" && i + 1 < argc) {
+            reps = std::max(1, atoi(argv[++i]));
+        } else {
+            std::cerr << "usage: compact [--size N] [--seed S] [--reps N]" << std::endl;
+            return 2;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    Type base = generate_large_random_type(size, 4, seed);
+    // Shapes are built one at a time, so that freeing one does not hand its
+    // memory to the next.
+    const char *names[] = {"generated", "scattered", "edited"};
+    std::cout << std::left << std::setw(16) << "shape" << std::right << std::setw(12) << "nodes"
+              << std::setw(12) << "compacted" << std::setw(12) << "before s" << std::setw(12) << "after s"
+              << std::setw(10) << "speedup" << std::endl;
+    for(int i = 0; i < 3; i++) {
+        Type shape = i == 0 ? Type(base) : i == 1 ? scattered(base, rng) : edited(base, rng);
+        double before = traversal_time(shape, reps);
+        CompactionReport report = compact(shape);
+        double after = traversal_time(shape, reps);
+        std::cout << std::left << std::setw(16) << names[i] << std::right << std::setw(12) << report.nodes_before
+                  << std::setw(12) << report.nodes_after << std::setw(12) << before << std::setw(12) << after
+                  << std::setw(9) << before / after << "x" << std::endl;
+    }
+}
@@ -0,0 +1,109 @@
+// One contract against many candidates: compares coinductive_sub::subtype on
+// each candidate with a CompiledContract (matcher.hpp) compiled once.
+//
+// usage: contract [--size N] [--candidates N] [--seed S] [--reps N]
+//
+// The contract is a random type of about --size nodes. Half the candidates
+// are unfoldings of it (subtypes that must be walked completely), the others
+// copies with one payload changed, which usually fail somewhere inside.
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+
+#include "type.hpp"
+#include "type_generator.hpp"
+#include "unfold.hpp"
+#include "subtyping.hpp"
+#include "matcher.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+const char *USAGE = "usage: contract [--size N] [--candidates N] [--seed S] [--reps N]";
+
+double seconds_since(Clock::time_point begin) {
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+// Copy of t with the payload of one input or output changed, if it has any.
+Type with_changed_payload(const Type &t, std::mt19937 &rng) {
+    Type result = t;
+    std::vector<graph::GraphNode*> messages;
+    for(graph::GraphNode *node : result.nodes) {
+        if(node->type() == graph::TypeIn || node->type() == graph::TypeOut) messages.push_back(node);
+    }
+    if(messages.empty()) return result;
+    graph::GraphNode *node = messages[rng() % messages.size()];
+    Sort &payload = node->type() == graph::TypeIn ? static_cast<graph::In*>(node)->payload : static_cast<graph::Out*>(node)->payload;
+    payload = static_cast<Sort>((payload + 1 + rng() % 2) % 3);
+    return result;
+}
+
+int main(int argc, char **argv) {
+    int size = 2000, count = 1000, reps = 3;
+    unsigned seed = 42;
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(arg == "--size" && i + 1 < argc) {
+            size = std::max(2, atoi(argv[++i]));
+        } else if(arg == "--candidates" && i + 1 < argc) {
+            count = std::max(1, atoi(argv[++i]));
+        } else if(arg == "--seed" && i + 1 < argc) {
+            seed = std::strtoul(argv[++i], nullptr, 10);
+        } else if(arg == "--reps" && i + 1 < argc) {
+            reps = std::max(1, atoi(argv[++i]));
+        } else {
+            std::cerr << USAGE << std::endl;
+            return 2;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    Type contract = generate_random_type(size, 3, rng, true, 2);
+    std::vector<Type> candidates;
+    candidates.reserve(count);
+    std::size_t candidate_nodes = 0;
+    for(int i = 0; i < count; i++) {
+        candidates.push_back(i % 2 == 0 ? unfold_once(contract) : with_changed_payload(contract, rng));
+        candidate_nodes += candidates.back().nodes.size();
+    }
+
+    CancelToken token(false);
+    std::vector<char> expected(count), matched(count);
+    double direct = 1e30, compiled = 1e30, compile = 1e30;
+    std::size_t states = 0, bytes = 0;
+    for(int rep = 0; rep < reps; rep++) {
+        Clock::time_point begin = Clock::now();
+        for(int i = 0; i < count; i++) {
+            expected[i] = coinductive_sub::subtype(candidates[i], contract, token);
+        }
+        direct = std::min(direct, seconds_since(begin));
+
+        begin = Clock::now();
+        CompiledContract matcher(contract);
+        compile = std::min(compile, seconds_since(begin));
+        for(int i = 0; i < count; i++) {
+            matched[i] = matcher.subtype(candidates[i], token);
+        }
+        compiled = std::min(compiled, seconds_since(begin));
+        states = matcher.states();
+        bytes = matcher.table_bytes();
+    }
+
+    int yes = std::count(expected.begin(), expected.end(), 1);
+    int disagreements = 0;
+    for(int i = 0; i < count; i++) {
+        disagreements += expected[i] != matched[i];
+    }
+    std::cout << "contract: " << contract.nodes.size() << " nodes, " << states << " states, " << bytes << " table bytes, compiled in "
+              << compile * 1e3 << " ms" << std::endl;
+    std::cout << count << " candidates of " << candidate_nodes / count << " nodes on average (" << yes << " subtypes)" << std::endl;
+    std::cout << "coinductive: " << direct << " s (" << count / direct << " candidates/s)" << std::endl;
+    std::cout << "compiled:    " << compiled << " s (" << count / compiled << " candidates/s, " << direct / compiled << "x)" << std::endl;
+    std::cout << disagreements << " disagreements" << std::endl;
+    return disagreements > 0 ? 1 : 0;
+}
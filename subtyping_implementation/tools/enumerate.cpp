@@ -0,0 +1,115 @@
+// Exhaustive enumeration of small types (enumerate.hpp). Counts every type
+// within the bounds by size and reports the throughput; with --write the
+// types are streamed as they are produced (see serialize.hpp) so they can be
+// piped into the batch driver or the fuzzer, which take consecutive records
+// as pairs. With --unfolded every type is followed by its unfolding, making
+// pairs whose answer is yes.
+//
+// usage: enumerate [--nodes N] [--labels B] [--participants P] [--threads T]
+//                  [--all-participants] [--write FILE|-] [--unfolded]
+//
+// Statistics go to stderr, so that --write - can feed a pipe.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+
+#include "enumerate.hpp"
+#include "serialize.hpp"
+#include "unfold.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    EnumerationBounds bounds;
+    unsigned threads = 0;
+    std::string output;
+    bool unfolded = false;
+};
+
+const char *USAGE = "usage: enumerate [--nodes N] [--labels B] [--participants P] [--threads T] [--all-participants] [--write FILE|-] [--unfolded]";
+
+// Records are buffered per worker and written in chunks of about this size.
+const std::size_t FLUSH_BYTES = 1 << 20;
+
+int main(int argc, char **argv) {
+    Options options;
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(arg == "--nodes" && i + 1 < argc) {
+            options.bounds.nodes = std::max(1, atoi(argv[++i]));
+        } else if(arg == "--labels" && i + 1 < argc) {
+            options.bounds.labels = std::min(MAX_ENUMERATED_LABELS, std::max(1, atoi(argv[++i])));
+        } else if(arg == "--participants" && i + 1 < argc) {
+            options.bounds.participants = std::max(1, atoi(argv[++i]));
+        } else if(arg == "--threads" && i + 1 < argc) {
+            options.threads = std::max(0, atoi(argv[++i]));
+        } else if(arg == "--all-participants") {
+            options.bounds.participant_symmetry = false;
+        } else if(arg == "--write" && i + 1 < argc) {
+            options.output = argv[++i];
+        } else if(arg == "--unfolded") {
+            options.unfolded = true;
+        } else {
+            std::cerr << USAGE << std::endl;
+            return 2;
+        }
+    }
+
+    std::ios_base::sync_with_stdio(false);
+    std::ofstream file;
+    if(!options.output.empty() && options.output != "-") {
+        file.open(options.output, std::ios::binary);
+        if(!file) {
+            std::cerr << "cannot open " << options.output << std::endl;
+            return 1;
+        }
+    }
+    std::ostream &out = options.output == "-" ? std::cout : file;
+    bool writing = !options.output.empty();
+
+    unsigned workers = options.threads;
+    if(workers == 0) workers = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::vector<unsigned long long>> by_size(workers, std::vector<unsigned long long>(options.bounds.nodes + 1, 0));
+    std::vector<std::ostringstream> buffers(workers);
+    std::mutex out_mutex;
+    auto flush = [&](std::ostringstream &buffer) {
+        std::lock_guard<std::mutex> lock(out_mutex);
+        out << buffer.str();
+        buffer.str("");
+    };
+
+    Clock::time_point begin = Clock::now();
+    unsigned long long count = enumerate_types(options.bounds, [&](Type &t, unsigned worker) {
+        by_size[worker][t.nodes.size()]++;
+        if(!writing) return;
+        std::ostringstream &buffer = buffers[worker];
+        write_type(buffer, t);
+        if(options.unfolded) write_type(buffer, unfold_once(t));
+        if(std::size_t(buffer.tellp()) >= FLUSH_BYTES) flush(buffer);
+    }, workers);
+    for(std::ostringstream &buffer : buffers) {
+        flush(buffer);
+    }
+    out.flush();
+    double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+    for(int n = 1; n <= options.bounds.nodes; n++) {
+        unsigned long long total = 0;
+        for(auto &sizes : by_size) total += sizes[n];
+        std::cerr << n << " nodes: " << total << " types" << std::endl;
+    }
+    std::cerr << count << " types in " << seconds << " s (" << (seconds > 0 ? count / seconds : 0) << " types/s, "
+              << workers << " threads)" << std::endl;
+    if(writing && !out) {
+        std::cerr << "write failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
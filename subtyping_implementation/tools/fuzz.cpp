@@ -0,0 +1,477 @@
+// Differential fuzzing of the subtyping engines. Generates random pairs (and
+// pairs derived by unfolding and mutation, for which the answer is often
+// "yes"), runs every registered engine on each, and shrinks any disagreement
+// to a minimal reproducer.
+//
+// usage: fuzz [--pairs N] [--time SECONDS] [--seed S] [--start I] [--size N]
+//             [--timeout MS] [--engine NAME]... [--input FILE|-]
+//
+// Pair I of a run only depends on the seed and I, so a reported pair can be
+// replayed with --start I --pairs 1.
+//
+// With --input, the pairs are instead consecutive records of a type stream
+// (see serialize.hpp), read one pair at a time until the stream ends, e.g.
+// the output of `enumerate --write -`.
+
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <cstdlib>
+#include <locale>
+#include <codecvt>
+
+#include "graph.hpp"
+#include "type.hpp"
+#include "type_generator.hpp"
+#include "unfold.hpp"
+#include "engines.hpp"
+#include "hard_instances.hpp"
+#include "compact.hpp"
+#include "serialize.hpp"
+
+using namespace graph;
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    unsigned long long pairs = 0; // 0: until the time budget runs out
+    double time = 10;
+    unsigned seed = 42;
+    unsigned long long start = 0;
+    int size = 40;
+    int timeout_ms = 1000;
+    std::vector<std::string> engines;
+    std::string input;
+};
+
+// Sets a cancel token once an armed deadline passes, so that an engine that
+// blows up on some pair is stopped instead of stalling the run.
+class Watchdog {
+    public:
+    explicit Watchdog(CancelToken &token) : token(token), worker([this] { loop(); }) {}
+
+    ~Watchdog() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        cv.notify_one();
+        worker.join();
+    }
+
+    void arm(std::chrono::milliseconds timeout) {
+        token.store(false);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            deadline = Clock::now() + timeout;
+            armed = true;
+        }
+        cv.notify_one();
+    }
+
+    void disarm() {
+        std::lock_guard<std::mutex> lock(mutex);
+        armed = false;
+    }
+
+    private:
+    void loop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while(!quit) {
+            if(!armed) {
+                cv.wait(lock);
+            } else if(cv.wait_until(lock, deadline) == std::cv_status::timeout && armed && Clock::now() >= deadline) {
+                token.store(true);
+                armed = false;
+            }
+        }
+    }
+
+    CancelToken &token;
+    std::mutex mutex;
+    std::condition_variable cv;
+    Clock::time_point deadline;
+    bool armed = false;
+    bool quit = false;
+    std::thread worker;
+};
+
+enum Outcome { No = 0, Yes = 1, Timeout = 2 };
+
+struct Runner {
+    std::vector<const Engine*> engines;
+    std::chrono::milliseconds timeout;
+    CancelToken token{false};
+    Watchdog watchdog{token};
+
+    std::vector<Outcome> run(Type &t1, Type &t2) {
+        std::vector<Outcome> outcomes;
+        for(const Engine *engine : engines) {
+            watchdog.arm(timeout);
+            bool result = engine->subtype(t1, t2, token, nullptr);
+            watchdog.disarm();
+            outcomes.push_back(token.load() ? Timeout : result ? Yes : No);
+        }
+        return outcomes;
+    }
+};
+
+// True if two engines that finished gave different answers, or if any of them
+// contradicts a known answer.
+bool disagree(const std::vector<Outcome> &outcomes, int expected = -1) {
+    int seen = expected;
+    for(Outcome outcome : outcomes) {
+        if(outcome == Timeout) continue;
+        if(seen >= 0 && seen != outcome) return true;
+        seen = outcome;
+    }
+    return false;
+}
+
+std::vector<GraphNode*> successors(GraphNode *node) {
+    std::vector<GraphNode*> result;
+    switch(node->type()) {
+        case TypeIn:
+            result.push_back(static_cast<In*>(node)->continuation);
+            break;
+        case TypeOut:
+            result.push_back(static_cast<Out*>(node)->continuation);
+            break;
+        case TypeBranch:
+            for(auto &branch : static_cast<Branch*>(node)->branches) result.push_back(branch.second);
+            break;
+        case TypeSelect:
+            for(auto &branch : static_cast<Select*>(node)->branches) result.push_back(branch.second);
+            break;
+        case TypeEnd:
+            break;
+    }
+    return result;
+}
+
+// Copy of t without the nodes unreachable from the root.
+Type reachable_part(const Type &t) {
+    Type copy = t;
+    compact(copy);
+    return copy;
+}
+
+// An end node of t, added if t has none.
+GraphNode* add_end(Type &t) {
+    for(GraphNode *node : t.nodes) {
+        if(node->type() == TypeEnd) return node;
+    }
+    End *end = new End();
+    t.nodes.push_back(end);
+    return end;
+}
+
+// Applies one random small edit to t: a payload, participant or target
+// change, or an added or removed label.
+void mutate(Type &t, std::mt19937 &rng) {
+    GraphNode *node = t.nodes[rng() % t.nodes.size()];
+    GraphNode *target = t.nodes[rng() % t.nodes.size()];
+    int choice = rng() % 3;
+    switch(node->type()) {
+        case TypeIn:
+        case TypeOut: {
+            bool in = node->type() == TypeIn;
+            Sort &payload = in ? static_cast<In*>(node)->payload : static_cast<Out*>(node)->payload;
+            Participant &participant = in ? static_cast<In*>(node)->participant : static_cast<Out*>(node)->participant;
+            GraphNode *&continuation = in ? static_cast<In*>(node)->continuation : static_cast<Out*>(node)->continuation;
+            if(choice == 0) payload = static_cast<Sort>(rng() % 3);
+            if(choice == 1) participant = rng() % 2;
+            if(choice == 2) continuation = target;
+            break;
+        }
+        case TypeBranch:
+        case TypeSelect: {
+            bool branch = node->type() == TypeBranch;
+            auto &branches = branch ? static_cast<Branch*>(node)->branches : static_cast<Select*>(node)->branches;
+            if(choice == 0) {
+                branches.push_back({branches.back().first + 1, target});
+            } else if(choice == 1 && branches.size() > 1) {
+                branches.erase(branches.begin() + rng() % branches.size());
+            } else {
+                branches[rng() % branches.size()].second = target;
+            }
+            break;
+        }
+        case TypeEnd:
+            break;
+    }
+}
+
+struct FuzzPair {
+    std::string kind;
+    Type t1;
+    Type t2;
+    int expected = -1; // known answer, if any
+};
+
+void swap_sides(FuzzPair &pair) {
+    std::swap(pair.t1.root, pair.t2.root);
+    std::swap(pair.t1.nodes, pair.t2.nodes);
+}
+
+// Builds pair number index of a run; the kinds below take turns.
+void make_pair(FuzzPair &pair, unsigned long long index, const Options &options) {
+    std::seed_seq seq{options.seed, static_cast<unsigned>(index), static_cast<unsigned>(index >> 32)};
+    std::mt19937 rng(seq);
+    int size = 2 + rng() % std::max(1, options.size - 1);
+    switch(index % 5) {
+        case 0:
+            pair.kind = "random";
+            pair.t1 = generate_random_type(size, 3, rng, true, 2);
+            pair.t2 = generate_random_type(size, 3, rng, true, 2);
+            break;
+        case 1:
+            pair.kind = "unfolded";
+            pair.t1 = generate_random_type(size, 3, rng, true, 2);
+            pair.t2 = unfold_once(pair.t1);
+            if(rng() % 2) swap_sides(pair);
+            pair.expected = Yes;
+            break;
+        case 2:
+        case 3: {
+            pair.kind = "mutated";
+            pair.t1 = generate_random_type(size, 3, rng, true, 2);
+            pair.t2 = pair.t1;
+            int edits = 1 + rng() % 3;
+            for(int i = 0; i < edits; i++) mutate(pair.t2, rng);
+            if(rng() % 2) swap_sides(pair);
+            break;
+        }
+        case 4: {
+            const std::vector<HardFamily> &families = hard_families();
+            const HardFamily &family = families[rng() % families.size()];
+            HardInstance instance = family.make(1 + rng() % (family.name == "exponential" ? 3 : 6));
+            pair.kind = "hard-" + family.name;
+            pair.t1 = instance.sub;
+            pair.t2 = instance.super;
+            pair.expected = instance.expected;
+            break;
+        }
+    }
+}
+
+// Candidate simplifications of t: moving the root to a child, and cutting
+// each edge over to end or dropping each label.
+std::vector<Type> shrink_candidates(const Type &t) {
+    std::vector<Type> candidates;
+    for(GraphNode *child : successors(t.root)) {
+        Type shifted;
+        std::map<GraphNode*, GraphNode*> mapping = copy_into_type(true, shifted, t);
+        shifted.root = mapping[child];
+        candidates.push_back(reachable_part(shifted));
+    }
+    for(size_t i = 0; i < t.nodes.size(); i++) {
+        GraphNode *node = t.nodes[i];
+        size_t edges = node->type() == TypeEnd ? 0 : successors(node).size();
+        for(size_t e = 0; e < edges; e++) {
+            for(int drop = 0; drop < 2; drop++) {
+                Type copy;
+                copy_into_type(true, copy, t);
+                GraphNode *target = copy.nodes[i];
+                switch(target->type()) {
+                    case TypeIn:
+                        if(drop || static_cast<In*>(target)->continuation->type() == TypeEnd) continue;
+                        static_cast<In*>(target)->continuation = add_end(copy);
+                        break;
+                    case TypeOut:
+                        if(drop || static_cast<Out*>(target)->continuation->type() == TypeEnd) continue;
+                        static_cast<Out*>(target)->continuation = add_end(copy);
+                        break;
+                    case TypeBranch:
+                    case TypeSelect: {
+                        auto &branches = target->type() == TypeBranch ? static_cast<Branch*>(target)->branches : static_cast<Select*>(target)->branches;
+                        if(drop && branches.size() > 1) {
+                            branches.erase(branches.begin() + e);
+                        } else if(!drop && branches[e].second->type() != TypeEnd) {
+                            branches[e].second = add_end(copy);
+                        } else {
+                            continue;
+                        }
+                        break;
+                    }
+                    case TypeEnd:
+                        break;
+                }
+                candidates.push_back(reachable_part(copy));
+            }
+        }
+    }
+    return candidates;
+}
+
+size_t size_of(const FuzzPair &pair) {
+    return pair.t1.nodes.size() + pair.t2.nodes.size();
+}
+
+// Nodes plus twice the edges into non-end nodes. Every accepted shrink step
+// must lower it, which rules out cycling, e.g. moving the root around a loop.
+size_t shrink_cost(const Type &t) {
+    size_t cost = t.nodes.size();
+    for(GraphNode *node : t.nodes) {
+        for(GraphNode *next : successors(node)) {
+            cost += next->type() == TypeEnd ? 0 : 2;
+        }
+    }
+    return cost;
+}
+
+// Greedily applies simplifications to either side for as long as the engines
+// keep disagreeing. A known answer no longer holds once the pair is edited,
+// so from then on only engine-engine disagreements count.
+void shrink(FuzzPair &pair, Runner &runner) {
+    bool progress = true;
+    while(progress) {
+        progress = false;
+        for(int side = 0; side < 2 && !progress; side++) {
+            Type &current = side == 0 ? pair.t1 : pair.t2;
+            size_t cost = shrink_cost(current);
+            for(Type &candidate : shrink_candidates(current)) {
+                if(shrink_cost(candidate) >= cost) continue;
+                Type &t1 = side == 0 ? candidate : pair.t1;
+                Type &t2 = side == 0 ? pair.t2 : candidate;
+                if(!disagree(runner.run(t1, t2))) continue;
+                current = candidate;
+                pair.expected = -1;
+                progress = true;
+                break;
+            }
+        }
+    }
+}
+
+std::string outcome_name(Outcome outcome) {
+    switch(outcome) {
+        case No: return "no";
+        case Yes: return "yes";
+        case Timeout: return "timeout";
+    }
+    return "?";
+}
+
+void report(const FuzzPair &pair, const std::vector<Outcome> &outcomes, const Runner &runner) {
+    for(size_t i = 0; i < outcomes.size(); i++) {
+        std::cout << "  " << runner.engines[i]->name << ": " << outcome_name(outcomes[i]) << std::endl;
+    }
+    if(pair.expected >= 0) {
+        std::cout << "  expected: " << outcome_name(static_cast<Outcome>(pair.expected)) << std::endl;
+    }
+    Type t1 = pair.t1, t2 = pair.t2;
+    std::wcout << L"  t1 (" << t1.nodes.size() << L" nodes): " << t1.to_string() << std::endl;
+    std::wcout << L"  t2 (" << t2.nodes.size() << L" nodes): " << t2.to_string() << std::endl;
+}
+
+int main(int argc, char **argv) {
+    // Set up UTF-8 output https://stackoverflow.com/questions/50053386/wcout-does-not-output-as-desired
+    std::ios_base::sync_with_stdio(false);
+    std::locale utf8( std::locale(), new std::codecvt_utf8_utf16<wchar_t> );
+    std::wcout.imbue(utf8);
+
+    Options options;
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(arg == "--pairs" && i + 1 < argc) {
+            options.pairs = std::strtoull(argv[++i], nullptr, 10);
+        } else if(arg == "--time" && i + 1 < argc) {
+            options.time = atof(argv[++i]);
+        } else if(arg == "--seed" && i + 1 < argc) {
+            options.seed = std::strtoul(argv[++i], nullptr, 10);
+        } else if(arg == "--start" && i + 1 < argc) {
+            options.start = std::strtoull(argv[++i], nullptr, 10);
+        } else if(arg == "--size" && i + 1 < argc) {
+            options.size = std::max(2, atoi(argv[++i]));
+        } else if(arg == "--timeout" && i + 1 < argc) {
+            options.timeout_ms = atoi(argv[++i]);
+        } else if(arg == "--engine" && i + 1 < argc) {
+            options.engines.push_back(argv[++i]);
+        } else if(arg == "--input" && i + 1 < argc) {
+            options.input = argv[++i];
+        } else {
+            std::cerr << "usage: fuzz [--pairs N] [--time SECONDS] [--seed S] [--start I] [--size N] [--timeout MS] [--engine NAME]... [--input FILE|-]" << std::endl;
+            return 2;
+        }
+    }
+
+    Runner runner;
+    runner.timeout = std::chrono::milliseconds(options.timeout_ms);
+    for(const Engine &engine : engines()) {
+        bool selected = options.engines.empty();
+        for(const std::string &name : options.engines) {
+            selected = selected || name == engine.name;
+        }
+        if(selected) runner.engines.push_back(&engine);
+    }
+    if(runner.engines.empty()) {
+        std::cerr << "no engines selected" << std::endl;
+        return 2;
+    }
+
+    std::ifstream file;
+    if(!options.input.empty() && options.input != "-") {
+        file.open(options.input, std::ios::binary);
+        if(!file) {
+            std::cerr << "cannot open " << options.input << std::endl;
+            return 1;
+        }
+    }
+    std::istream &in = options.input == "-" ? std::cin : file;
+    bool streamed = !options.input.empty();
+
+    std::cout << "fuzzing";
+    for(const Engine *engine : runner.engines) std::cout << " " << engine->name;
+    if(streamed) {
+        std::cout << " on " << options.input << std::endl;
+    } else {
+        std::cout << " with seed " << options.seed << std::endl;
+    }
+
+    std::map<std::string, unsigned long long> checked;
+    unsigned long long timeouts = 0, disagreements = 0, done = 0;
+    Clock::time_point begin = Clock::now();
+    double elapsed = 0;
+    for(unsigned long long index = options.start; ; index++) {
+        elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+        if(options.pairs ? done >= options.pairs : !streamed && elapsed >= options.time) break;
+
+        FuzzPair pair;
+        if(!streamed) {
+            make_pair(pair, index, options);
+        } else if(read_type(in, pair.t1) && read_type(in, pair.t2)) {
+            pair.kind = "input";
+        } else {
+            if(!in.eof()) std::cerr << "malformed record after " << 2 * done << " types" << std::endl;
+            break;
+        }
+        std::vector<Outcome> outcomes = runner.run(pair.t1, pair.t2);
+        done++;
+        checked[pair.kind]++;
+        for(Outcome outcome : outcomes) timeouts += outcome == Timeout;
+        if(!disagree(outcomes, pair.expected)) continue;
+
+        disagreements++;
+        std::cout << "disagreement on pair " << index << " (" << pair.kind << ", " << size_of(pair) << " nodes)" << std::endl;
+        report(pair, outcomes, runner);
+        shrink(pair, runner);
+        std::cout << "shrunk to " << size_of(pair) << " nodes" << std::endl;
+        report(pair, runner.run(pair.t1, pair.t2), runner);
+    }
+
+    std::cout << done << " pairs in " << elapsed << " s (" << (elapsed > 0 ? done / elapsed : 0) << " pairs/s)" << std::endl;
+    for(auto &entry : checked) {
+        std::cout << "  " << entry.first << ": " << entry.second << std::endl;
+    }
+    std::cout << timeouts << " timeouts, " << disagreements << " disagreements" << std::endl;
+    return disagreements > 0 ? 1 : 0;
+}
@@ -0,0 +1,130 @@
+// Lazy lowering (lazy.hpp) against parse_ast on large ASTs: a type is checked
+// against a copy of itself in which one node's payload is changed, and once
+// against an unchanged copy, which has to be explored completely.
+//
+// usage: lazy [--size N] [--fault K]... [--reps N]
+//
+// The AST has about --size nodes, choices with two labels alternating with
+// messages, and every leaf recurses back to the root. --fault K changes the
+// first message at or after the K-th node in preorder (default 10, 1% and
+// 50% of the size).
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+
+#include "ast.hpp"
+#include "parse.hpp"
+#include "lazy.hpp"
+#include "subtyping.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+const char *USAGE = "usage: lazy [--size N] [--fault K]... [--reps N]";
+
+double seconds_since(Clock::time_point begin) {
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+struct AstBuilder {
+    std::vector<std::shared_ptr<void>> pool;
+    long next = 0; // preorder number of the next node
+    long fault; // the first message at or after this node gets a different payload
+    bool faulted = false;
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        auto node = std::make_shared<T>(std::forward<Args>(args)...);
+        pool.push_back(node);
+        return node.get();
+    }
+
+    // A subtree of n nodes at the given depth.
+    ast::ASTNode* build(long n, int depth) {
+        long id = next++;
+        if(n <= 1) return make<ast::Var>(0);
+        Participant participant = id % 2;
+        if(depth % 2 == 1) {
+            Sort payload = Int;
+            if(fault >= 0 && id >= fault && !faulted) {
+                payload = Bool;
+                faulted = true;
+            }
+            ast::ASTNode *continuation = build(n - 1, depth + 1);
+            if(id % 4 == 1) return make<ast::In>(participant, payload, continuation);
+            return make<ast::Out>(participant, payload, continuation);
+        }
+        std::vector<std::pair<ast::Label, ast::ASTNode*>> branches;
+        branches.push_back({0, build((n - 1) / 2, depth + 1)});
+        branches.push_back({1, build(n - 1 - (n - 1) / 2, depth + 1)});
+        if(id % 4 == 0) return make<ast::Select>(participant, branches);
+        return make<ast::Branch>(participant, branches);
+    }
+
+    ast::ASTNode* root(long n) {
+        return make<ast::Mu>(0, build(n, 0));
+    }
+};
+
+int main(int argc, char **argv) {
+    long size = 1000000;
+    int reps = 3;
+    std::vector<long> faults;
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(arg == "--size" && i + 1 < argc) {
+            size = std::max(2L, atol(argv[++i]));
+        } else if(arg == "--fault" && i + 1 < argc) {
+            faults.push_back(atol(argv[++i]));
+        } else if(arg == "--reps" && i + 1 < argc) {
+            reps = std::max(1, atoi(argv[++i]));
+        } else {
+            std::cerr << USAGE << std::endl;
+            return 2;
+        }
+    }
+    if(faults.empty()) faults = {10, size / 100, size / 2};
+    faults.push_back(-1);
+
+    AstBuilder original;
+    original.fault = -1;
+    ast::ASTNode *t1 = original.root(size);
+    std::size_t lowered = parse_ast(t1).nodes.size();
+
+    CancelToken token(false);
+    int mismatches = 0;
+    for(long fault : faults) {
+        AstBuilder changed;
+        changed.fault = fault;
+        ast::ASTNode *t2 = changed.root(size);
+
+        double eager = 1e30, lazy = 1e30;
+        bool eager_result = false, lazy_result = false;
+        std::size_t materialized = 0;
+        for(int rep = 0; rep < reps; rep++) {
+            Clock::time_point begin = Clock::now();
+            {
+                Type lowered1 = parse_ast(t1), lowered2 = parse_ast(t2);
+                eager_result = coinductive_sub::subtype(lowered1, lowered2, token);
+            }
+            eager = std::min(eager, seconds_since(begin));
+
+            begin = Clock::now();
+            {
+                LazyType lazy1(t1), lazy2(t2);
+                lazy_result = coinductive_sub::subtype(lazy1, lazy2, token);
+                materialized = lazy1.materialized() + lazy2.materialized();
+            }
+            lazy = std::min(lazy, seconds_since(begin));
+        }
+        mismatches += eager_result != lazy_result;
+        std::cout << (fault < 0 ? std::string("no fault") : "fault at " + std::to_string(fault)) << ": "
+                  << (lazy_result ? "yes" : "no") << "; eager " << eager * 1e3 << " ms, lazy " << lazy * 1e3 << " ms ("
+                  << materialized << " of " << 2 * lowered << " nodes lowered)" << std::endl;
+    }
+    return mismatches > 0 ? 1 : 0;
+}
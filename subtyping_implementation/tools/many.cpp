@@ -0,0 +1,179 @@
+// One subtype against many supertypes: compares coinductive_sub::subtype on
+// each supertype with a single subtype_many call (many.hpp).
+//
+// usage: many [--size N] [--supers N] [--seed S] [--reps N] [--copies]
+//
+// The subtype is a random type of about --size nodes. The supertypes are
+// versions of it made by path copying, as a persistent editor would keep
+// them: each copies the path from the root to one node and shares every
+// other node with the original. Half the versions are otherwise unchanged,
+// so the subtype checks against them must walk everything; the others have
+// the payload at the end of the path changed, and usually fail there.
+//
+// With --copies the supertypes are separate copies instead (unfoldings, and
+// copies with one payload changed), which share no nodes: subtype_many has
+// to read all of them to find the structure they have in common.
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+
+#include "type.hpp"
+#include "type_generator.hpp"
+#include "unfold.hpp"
+#include "subtyping.hpp"
+#include "many.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+const char *USAGE = "usage: many [--size N] [--supers N] [--seed S] [--reps N] [--copies]";
+
+double seconds_since(Clock::time_point begin) {
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+std::vector<graph::GraphNode*> successors(graph::GraphNode *node) {
+    std::vector<graph::GraphNode*> result;
+    switch(node->type()) {
+        case graph::TypeIn: result.push_back(static_cast<graph::In*>(node)->continuation); break;
+        case graph::TypeOut: result.push_back(static_cast<graph::Out*>(node)->continuation); break;
+        case graph::TypeBranch: for(auto &branch : static_cast<graph::Branch*>(node)->branches) result.push_back(branch.second); break;
+        case graph::TypeSelect: for(auto &branch : static_cast<graph::Select*>(node)->branches) result.push_back(branch.second); break;
+        case graph::TypeEnd: break;
+    }
+    return result;
+}
+
+// Points the edges of node that lead to from at to instead.
+void redirect(graph::GraphNode *node, graph::GraphNode *from, graph::GraphNode *to) {
+    switch(node->type()) {
+        case graph::TypeIn: static_cast<graph::In*>(node)->continuation = to; break;
+        case graph::TypeOut: static_cast<graph::Out*>(node)->continuation = to; break;
+        case graph::TypeBranch:
+            for(auto &branch : static_cast<graph::Branch*>(node)->branches) if(branch.second == from) branch.second = to;
+            break;
+        case graph::TypeSelect:
+            for(auto &branch : static_cast<graph::Select*>(node)->branches) if(branch.second == from) branch.second = to;
+            break;
+        case graph::TypeEnd: break;
+    }
+}
+
+// Changes the payload of node, if it is an input or output.
+void change_payload(graph::GraphNode *node, std::mt19937 &rng) {
+    if(node->type() != graph::TypeIn && node->type() != graph::TypeOut) return;
+    Sort &payload = node->type() == graph::TypeIn ? static_cast<graph::In*>(node)->payload : static_cast<graph::Out*>(node)->payload;
+    payload = static_cast<Sort>((payload + 1 + rng() % 2) % 3);
+}
+
+// Copy of t with the payload of one input or output changed, if it has any.
+Type with_changed_payload(const Type &t, std::mt19937 &rng) {
+    Type result = t;
+    std::vector<graph::GraphNode*> messages;
+    for(graph::GraphNode *node : result.nodes) {
+        if(node->type() == graph::TypeIn || node->type() == graph::TypeOut) messages.push_back(node);
+    }
+    if(!messages.empty()) change_payload(messages[rng() % messages.size()], rng);
+    return result;
+}
+
+// Root of a version of t in which the nodes on a shortest path from the root
+// to a random node are copies, the copy of that node with its payload
+// changed if edit is set. The copies are added to arena.
+graph::GraphNode* path_copy(const Type &t, bool edit, std::mt19937 &rng, Type &arena) {
+    std::map<graph::GraphNode*, graph::GraphNode*> parent = {{t.root, nullptr}};
+    std::vector<graph::GraphNode*> order = {t.root};
+    for(std::size_t i = 0; i < order.size(); i++) {
+        for(graph::GraphNode *next : successors(order[i])) {
+            if(parent.emplace(next, order[i]).second) order.push_back(next);
+        }
+    }
+    graph::GraphNode *target = order[rng() % order.size()];
+    graph::GraphNode *copy = target->copy(), *below = target;
+    arena.nodes.push_back(copy);
+    if(edit) change_payload(copy, rng);
+    for(graph::GraphNode *node = parent[target]; node != nullptr; node = parent[node]) {
+        graph::GraphNode *above = node->copy();
+        arena.nodes.push_back(above);
+        redirect(above, below, copy);
+        below = node;
+        copy = above;
+    }
+    return copy;
+}
+
+int main(int argc, char **argv) {
+    int size = 2000, count = 100, reps = 3;
+    unsigned seed = 42;
+    bool copies = false;
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(arg == "--size" && i + 1 < argc) {
+            size = std::max(2, atoi(argv[++i]));
+        } else if(arg == "--supers" && i + 1 < argc) {
+            count = std::max(1, atoi(argv[++i]));
+        } else if(arg == "--seed" && i + 1 < argc) {
+            seed = std::strtoul(argv[++i], nullptr, 10);
+        } else if(arg == "--reps" && i + 1 < argc) {
+            reps = std::max(1, atoi(argv[++i]));
+        } else if(arg == "--copies") {
+            copies = true;
+        } else {
+            std::cerr << USAGE << std::endl;
+            return 2;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    Type sub = generate_random_type(size, 3, rng, true, 2);
+    // Versions own no nodes; the original and every copied path are in arena.
+    Type arena = sub;
+    std::vector<Type> supers;
+    supers.reserve(count);
+    for(int i = 0; i < count; i++) {
+        if(copies) {
+            supers.push_back(i % 2 == 0 ? unfold_once(sub) : with_changed_payload(sub, rng));
+        } else {
+            supers.emplace_back();
+            supers.back().root = path_copy(arena, i % 2 == 1, rng, arena);
+        }
+    }
+    std::vector<Type*> pointers;
+    for(Type &t : supers) pointers.push_back(&t);
+
+    CancelToken token(false);
+    std::vector<char> expected(count);
+    std::vector<Verdict> verdicts;
+    ManyStats stats;
+    double separate = 1e30, together = 1e30;
+    for(int rep = 0; rep < reps; rep++) {
+        Clock::time_point begin = Clock::now();
+        for(int i = 0; i < count; i++) {
+            expected[i] = coinductive_sub::subtype(sub, supers[i], token);
+        }
+        separate = std::min(separate, seconds_since(begin));
+
+        begin = Clock::now();
+        verdicts = subtype_many(sub, pointers, nullptr, &stats);
+        together = std::min(together, seconds_since(begin));
+    }
+
+    int yes = std::count(expected.begin(), expected.end(), 1);
+    int disagreements = 0;
+    for(int i = 0; i < count; i++) {
+        disagreements += verdicts[i] != (expected[i] ? Verdict::Yes : Verdict::No);
+    }
+    std::cout << "subtype: " << sub.nodes.size() << " nodes; " << count << (copies ? " copies" : " versions") << " ("
+              << yes << " supertypes)" << std::endl;
+    std::cout << "merged " << stats.super_nodes << " supertype nodes into " << stats.classes << " classes, "
+              << stats.pairs << " product states" << std::endl;
+    std::cout << "separate:     " << separate << " s" << std::endl;
+    std::cout << "subtype_many: " << together << " s (" << separate / together << "x)" << std::endl;
+    std::cout << disagreements << " disagreements" << std::endl;
+    return disagreements > 0 ? 1 : 0;
+}
@@ -0,0 +1,319 @@
+// Component microbenchmarks: ns/node and allocations/node of the building
+// blocks underneath subtype, across sizes from 10 to 10^6 nodes, with a
+// log-log slope per component to catch complexity regressions.
+//
+// usage: microbench [--max N] [--budget SECONDS] [--strict]
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+#include "graph.hpp"
+#include "type.hpp"
+#include "type_generator.hpp"
+#include "subtyping.hpp"
+#include "unfold.hpp"
+#include "ast.hpp"
+#include "parse.hpp"
+
+// Allocation counting, for the thread running the benchmarks. GCC cannot see
+// that the replacement new and delete below are paired.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static thread_local unsigned long long allocations = 0;
+static thread_local unsigned long long allocated_bytes = 0;
+
+void* operator new(std::size_t size) {
+    allocations++;
+    allocated_bytes += size;
+    if(void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+struct Component {
+    std::string name;
+    double expected_exponent;
+    // Builds the inputs for size n outside the timed region and returns the
+    // operation to time, which reports how many nodes it processed.
+    std::function<std::function<size_t()>(int n)> prepare;
+};
+
+struct Sample {
+    int n;
+    size_t nodes;
+    double ns_per_call;
+    double allocs_per_call;
+    double bytes_per_call;
+};
+
+static std::shared_ptr<Type> random_type(int n) {
+    std::mt19937 rng(n);
+    return std::make_shared<Type>(generate_random_type(n, 4, rng, true, 2));
+}
+
+// Converts a generated type back into an AST. Back edges become Mu/Var pairs;
+// nodes shared without a cycle are duplicated.
+struct AstBuilder {
+    std::vector<std::shared_ptr<void>> pool;
+    std::set<graph::GraphNode*> on_path;
+    std::set<graph::GraphNode*> targets;
+    std::map<graph::GraphNode*, int> vars;
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        auto node = std::make_shared<T>(std::forward<Args>(args)...);
+        pool.push_back(node);
+        return node.get();
+    }
+
+    static std::vector<graph::GraphNode*> successors(graph::GraphNode *node) {
+        std::vector<graph::GraphNode*> result;
+        switch(node->type()) {
+            case graph::TypeIn: result.push_back(static_cast<graph::In*>(node)->continuation); break;
+            case graph::TypeOut: result.push_back(static_cast<graph::Out*>(node)->continuation); break;
+            case graph::TypeBranch: for(auto &b : static_cast<graph::Branch*>(node)->branches) result.push_back(b.second); break;
+            case graph::TypeSelect: for(auto &b : static_cast<graph::Select*>(node)->branches) result.push_back(b.second); break;
+            case graph::TypeEnd: break;
+        }
+        return result;
+    }
+
+    void find_targets(graph::GraphNode *node) {
+        on_path.insert(node);
+        for(graph::GraphNode *next : successors(node)) {
+            if(on_path.count(next)) targets.insert(next);
+            else find_targets(next);
+        }
+        on_path.erase(node);
+    }
+
+    ast::ASTNode* build(graph::GraphNode *node) {
+        if(on_path.count(node)) return make<ast::Var>(vars[node]);
+        on_path.insert(node);
+        ast::ASTNode *result = nullptr;
+        switch(node->type()) {
+            case graph::TypeIn: {
+                auto in = static_cast<graph::In*>(node);
+                result = make<ast::In>(in->participant, in->payload, build(in->continuation));
+                break;
+            }
+            case graph::TypeOut: {
+                auto out = static_cast<graph::Out*>(node);
+                result = make<ast::Out>(out->participant, out->payload, build(out->continuation));
+                break;
+            }
+            case graph::TypeBranch: {
+                std::vector<std::pair<ast::Label, ast::ASTNode*>> branches;
+                for(auto &b : static_cast<graph::Branch*>(node)->branches) branches.push_back({b.first, build(b.second)});
+                result = make<ast::Branch>(static_cast<graph::Branch*>(node)->participant, branches);
+                break;
+            }
+            case graph::TypeSelect: {
+                std::vector<std::pair<ast::Label, ast::ASTNode*>> branches;
+                for(auto &b : static_cast<graph::Select*>(node)->branches) branches.push_back({b.first, build(b.second)});
+                result = make<ast::Select>(static_cast<graph::Select*>(node)->participant, branches);
+                break;
+            }
+            case graph::TypeEnd:
+                result = make<ast::End>();
+                break;
+        }
+        on_path.erase(node);
+        if(targets.count(node)) result = make<ast::Mu>(vars[node], result);
+        return result;
+    }
+
+    ast::ASTNode* convert(Type &t) {
+        find_targets(t.root);
+        int next_var = 0;
+        for(graph::GraphNode *target : targets) vars[target] = next_var++;
+        return build(t.root);
+    }
+};
+
+static std::vector<Component> components() {
+    return {
+        {"generate_random_type", 1.0, [](int n) -> std::function<size_t()> {
+            return [n]() { std::mt19937 rng(n); return generate_random_type(n, 4, rng, true, 2).nodes.size(); };
+        }},
+        {"generate_large_random_type", 1.0, [](int n) -> std::function<size_t()> {
+            return [n]() { return generate_large_random_type(n, 4, n, 0).nodes.size(); };
+        }},
+        {"generate_random_isomorphic_type", 1.0, [](int n) -> std::function<size_t()> {
+            return [n]() { std::mt19937 rng(n); return generate_random_isomorphic_type(n, rng).nodes.size(); };
+        }},
+        {"generate_exponential_counterexample", 1.0, [](int n) -> std::function<size_t()> {
+            int k = std::max(1, static_cast<int>(std::sqrt(2.0 * n)));
+            return [k]() { return generate_exponential_counterexample(k).nodes.size(); };
+        }},
+        {"copy_into_type", 1.0, [](int n) -> std::function<size_t()> {
+            auto t = random_type(n);
+            return [t]() { Type copy; copy_into_type(true, copy, *t); return copy.nodes.size(); };
+        }},
+        {"Type::operator=", 1.0, [](int n) -> std::function<size_t()> {
+            auto t = random_type(n);
+            auto target = std::make_shared<Type>(*t);
+            return [t, target]() { *target = *t; return target->nodes.size(); };
+        }},
+        {"unfold_once", 1.0, [](int n) -> std::function<size_t()> {
+            auto t = random_type(n);
+            // Normalised by input size: the output can be quadratically larger.
+            return [t]() { unfold_once(*t); return t->nodes.size(); };
+        }},
+        {"Type::to_string", 1.0, [](int n) -> std::function<size_t()> {
+            auto t = random_type(n);
+            return [t]() { t->to_string(); return t->nodes.size(); };
+        }},
+        {"parse_ast", 1.0, [](int n) -> std::function<size_t()> {
+            auto t = random_type(n);
+            auto builder = std::make_shared<AstBuilder>();
+            ast::ASTNode *root = builder->convert(*t);
+            return [builder, root]() { return parse_ast(root).nodes.size(); };
+        }},
+        {"inductive_sub::subtype", 1.0, [](int n) -> std::function<size_t()> {
+            auto t1 = random_type(n);
+            auto t2 = std::make_shared<Type>(*t1);
+            return [t1, t2]() { CancelToken h(false); inductive_sub::subtype(*t1, *t2, h); return t1->nodes.size(); };
+        }},
+        {"coinductive_sub::subtype", 1.0, [](int n) -> std::function<size_t()> {
+            auto t1 = random_type(n);
+            auto t2 = std::make_shared<Type>(*t1);
+            return [t1, t2]() { CancelToken h(false); coinductive_sub::subtype(*t1, *t2, h); return t1->nodes.size(); };
+        }},
+    };
+}
+
+static Sample measure(const std::function<size_t()> &op, int n, double min_seconds) {
+    Sample sample;
+    sample.n = n;
+    unsigned long long allocs_before = allocations, bytes_before = allocated_bytes;
+    auto start = std::chrono::steady_clock::now();
+    sample.nodes = op();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    sample.allocs_per_call = allocations - allocs_before;
+    sample.bytes_per_call = allocated_bytes - bytes_before;
+
+    // Repeat cheap operations until the total is long enough to time.
+    long long reps = 1;
+    while(std::chrono::duration<double>(elapsed).count() < min_seconds) {
+        long long batch = reps;
+        start = std::chrono::steady_clock::now();
+        for(long long i = 0; i < batch; i++) op();
+        elapsed = std::chrono::steady_clock::now() - start;
+        reps = batch * 2;
+        sample.ns_per_call = std::chrono::duration<double, std::nano>(elapsed).count() / batch;
+    }
+    if(reps == 1) sample.ns_per_call = std::chrono::duration<double, std::nano>(elapsed).count();
+    return sample;
+}
+
+// Least-squares slope of log(time) against log(nodes).
+static double fit_exponent(const std::vector<Sample> &samples) {
+    std::vector<std::pair<double, double>> points;
+    for(const Sample &s : samples) {
+        if(s.nodes >= 100 && s.ns_per_call > 0) points.push_back({std::log(s.nodes), std::log(s.ns_per_call)});
+    }
+    if(points.size() < 2) return NAN;
+    double mx = 0, my = 0;
+    for(auto &p : points) { mx += p.first; my += p.second; }
+    mx /= points.size();
+    my /= points.size();
+    double sxy = 0, sxx = 0;
+    for(auto &p : points) {
+        sxy += (p.first - mx) * (p.second - my);
+        sxx += (p.first - mx) * (p.first - mx);
+    }
+    return sxy / sxx;
+}
+
+struct Options {
+    int max_size = 1'000'000;
+    double budget = 2.0;
+    bool strict = false;
+    int regressions = 0;
+};
+
+static void run(Options &options) {
+    std::cout << "component,n,nodes,ns_per_node,allocs_per_node,bytes_per_node" << std::endl;
+    std::vector<std::string> summary;
+    for(const Component &component : components()) {
+        std::vector<Sample> samples;
+        bool truncated = false;
+        for(int n = 10; n <= options.max_size; n *= 10) {
+            std::function<size_t()> op = component.prepare(n);
+            Sample s = measure(op, n, 0.05);
+            samples.push_back(s);
+            double nodes = std::max<size_t>(1, s.nodes);
+            std::cout << component.name << ',' << n << ',' << s.nodes << ','
+                << s.ns_per_call / nodes << ',' << s.allocs_per_call / nodes << ',' << s.bytes_per_call / nodes << std::endl;
+            if(s.ns_per_call > options.budget * 1e9 && n < options.max_size) {
+                truncated = true;
+                break;
+            }
+        }
+        double exponent = fit_exponent(samples);
+        bool regression = exponent > component.expected_exponent + 0.25;
+        options.regressions += regression;
+        summary.push_back("# " + component.name + ": exponent " + std::to_string(exponent)
+            + " (expected " + std::to_string(component.expected_exponent) + ")"
+            + (regression ? " SUPERLINEAR" : "") + (truncated ? " [stopped at time budget]" : ""));
+    }
+    for(const std::string &line : summary) {
+        std::cout << line << std::endl;
+    }
+}
+
+static void* run_thread(void *arg) {
+    run(*static_cast<Options*>(arg));
+    return nullptr;
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--max") == 0 && i + 1 < argc) {
+            options.max_size = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            options.budget = atof(argv[++i]);
+        } else if(strcmp(argv[i], "--strict") == 0) {
+            options.strict = true;
+        } else {
+            std::cerr << "usage: microbench [--max N] [--budget SECONDS] [--strict]" << std::endl;
+            return 2;
+        }
+    }
+
+    // The generators, printer and engines recurse once per node, so large
+    // sizes need far more stack than the default.
+#ifdef __linux__
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, 1ull << 30);
+    pthread_t thread;
+    pthread_create(&thread, &attr, run_thread, &options);
+    pthread_join(thread, nullptr);
+    pthread_attr_destroy(&attr);
+#else
+    run_thread(&options);
+#endif
+    return options.strict && options.regressions > 0 ? 1 : 0;
+}
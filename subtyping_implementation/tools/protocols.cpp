@@ -0,0 +1,110 @@
+// Protocols written with static_type.hpp. Their relationships are checked by
+// static_assert when this file compiles; at run time the same pairs are
+// bridged to Type and checked with coinductive_sub, and any disagreement is
+// reported.
+//
+// usage: protocols [--reps N]
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <locale>
+#include <codecvt>
+#include <cstdlib>
+
+#include "static_type.hpp"
+#include "subtyping.hpp"
+
+using namespace static_type;
+using Clock = std::chrono::steady_clock;
+
+// A key-value server, from the server's side; participant 0 is the client.
+enum : Label { GET, PUT, QUIT, FOUND, MISSING };
+
+using Server = Mu<0, Branch<0,
+    Case<GET, In<0, Nat, Select<0,
+        Case<FOUND, Out<0, Int, Var<0>>>,
+        Case<MISSING, Var<0>>>>>,
+    Case<PUT, In<0, Nat, In<0, Int, Var<0>>>>,
+    Case<QUIT, End>>>;
+
+// Serves fewer requests and only ever returns naturals.
+using ReadOnlyServer = Mu<0, Branch<0,
+    Case<QUIT, End>,
+    Case<GET, In<0, Nat, Select<0,
+        Case<FOUND, Out<0, Nat, Var<0>>>,
+        Case<MISSING, Var<0>>>>>>>;
+
+// Server with its first request unrolled.
+using UnrolledServer = Branch<0,
+    Case<GET, In<0, Nat, Select<0,
+        Case<FOUND, Out<0, Int, Server>>,
+        Case<MISSING, Server>>>>,
+    Case<PUT, In<0, Nat, In<0, Int, Server>>>,
+    Case<QUIT, End>>;
+
+// Answers a lookup with a boolean.
+using BrokenServer = Mu<0, Branch<0,
+    Case<GET, In<0, Nat, Select<0,
+        Case<FOUND, Out<0, Bool, Var<0>>>,
+        Case<MISSING, Var<0>>>>>,
+    Case<QUIT, End>>>;
+
+// Never reports a miss.
+using OptimisticServer = Mu<0, Branch<0,
+    Case<GET, In<0, Nat, Select<0, Case<FOUND, Out<0, Int, Var<0>>>>>>,
+    Case<QUIT, End>>>;
+
+static_assert(subtype<Server, Server>());
+static_assert(subtype<ReadOnlyServer, Server>());
+static_assert(!subtype<Server, ReadOnlyServer>());
+static_assert(subtype<UnrolledServer, Server>() && subtype<Server, UnrolledServer>());
+static_assert(!subtype<BrokenServer, Server>());
+static_assert(!subtype<OptimisticServer, Server>());
+
+template <typename Sub, typename Super>
+int check(const char *name, int reps) {
+    constexpr bool expected = subtype<Sub, Super>();
+    Type t1 = to_type<Sub>(), t2 = to_type<Super>();
+    CancelToken token(false);
+    bool result = coinductive_sub::subtype(t1, t2, token);
+
+    Clock::time_point begin = Clock::now();
+    std::size_t nodes = 0;
+    for(int i = 0; i < reps; i++) {
+        nodes += to_type<Sub>().nodes.size();
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / reps;
+
+    std::cout << name << ": " << (expected ? "yes" : "no") << " at compile time, " << (result ? "yes" : "no") << " at run time; "
+              << nodes / reps << " nodes bridged in " << ns << " ns" << std::endl;
+    return expected != result;
+}
+
+int main(int argc, char **argv) {
+    int reps = 10000;
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(arg == "--reps" && i + 1 < argc) {
+            reps = std::max(1, atoi(argv[++i]));
+        } else {
+            std::cerr << "usage: protocols [--reps N]" << std::endl;
+            return 2;
+        }
+    }
+
+    std::ios_base::sync_with_stdio(false);
+    std::locale utf8(std::locale(), new std::codecvt_utf8_utf16<wchar_t>);
+    std::wcout.imbue(utf8);
+    std::wcout << L"Server = " << to_type<Server>().to_string() << std::endl;
+
+    int mismatches = 0;
+    mismatches += check<Server, Server>("Server <= Server", reps);
+    mismatches += check<ReadOnlyServer, Server>("ReadOnlyServer <= Server", reps);
+    mismatches += check<Server, ReadOnlyServer>("Server <= ReadOnlyServer", reps);
+    mismatches += check<UnrolledServer, Server>("UnrolledServer <= Server", reps);
+    mismatches += check<Server, UnrolledServer>("Server <= UnrolledServer", reps);
+    mismatches += check<BrokenServer, Server>("BrokenServer <= Server", reps);
+    mismatches += check<OptimisticServer, Server>("OptimisticServer <= Server", reps);
+    return mismatches > 0 ? 1 : 0;
+}
@@ -0,0 +1,115 @@
+// Records an execution trace of one check and writes it as Chrome trace-event
+// JSON, for chrome://tracing or Perfetto. Recording needs a tracing build:
+// make clean && make TRACE=1 && make TRACE=1 tools
+//
+// usage: trace [--worst-case K | --hard FAMILY N] [--inductive] [--reps N]
+//              [--capacity EVENTS] [--out FILE]
+//
+// The check is also timed untraced, to report the overhead of recording; the
+// best of --reps runs of each is compared. Untraced runs in a tracing build
+// take the same code path as a build without tracing, but to measure the
+// full cost of a tracing build, compare its traced time with the time this
+// tool reports when built without tracing, where it only times the check.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+
+#include "type.hpp"
+#include "type_generator.hpp"
+#include "hard_instances.hpp"
+#include "subtyping.hpp"
+#include "trace.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+const char *USAGE = "usage: trace [--worst-case K | --hard FAMILY N] [--inductive] [--reps N] [--capacity EVENTS] [--out FILE]";
+
+int main(int argc, char **argv) {
+    std::string family, out_path = "trace.json";
+    int n = 8, reps = 3;
+    bool inductive = false;
+    std::size_t capacity = 1 << 16;
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(arg == "--worst-case" && i + 1 < argc) {
+            family.clear();
+            n = std::max(1, atoi(argv[++i]));
+        } else if(arg == "--hard" && i + 2 < argc) {
+            family = argv[++i];
+            n = std::max(1, atoi(argv[++i]));
+        } else if(arg == "--inductive") {
+            inductive = true;
+        } else if(arg == "--reps" && i + 1 < argc) {
+            reps = std::max(1, atoi(argv[++i]));
+        } else if(arg == "--capacity" && i + 1 < argc) {
+            capacity = std::max(1L, atol(argv[++i]));
+        } else if(arg == "--out" && i + 1 < argc) {
+            out_path = argv[++i];
+        } else {
+            std::cerr << USAGE << std::endl;
+            return 2;
+        }
+    }
+
+    Type t1, t2;
+    if(family.empty()) {
+        t1 = generate_exponential_counterexample(n);
+        t2 = generate_exponential_counterexample(n + 1);
+    } else {
+        const HardFamily *f = find_hard_family(family);
+        if(f == nullptr) {
+            std::cerr << "unknown family " << family << std::endl;
+            return 2;
+        }
+        HardInstance instance = f->make(n);
+        t1 = instance.sub;
+        t2 = instance.super;
+    }
+
+    CancelToken token(false);
+    auto check = [&] {
+        return inductive ? inductive_sub::subtype(t1, t2, token) : coinductive_sub::subtype(t1, t2, token);
+    };
+    if(!TRACE_ENABLED) {
+        // Only the baseline that a tracing build is compared against.
+        bool result = false;
+        double untraced = 1e30;
+        for(int i = 0; i < reps; i++) {
+            Clock::time_point begin = Clock::now();
+            result = check();
+            untraced = std::min(untraced, std::chrono::duration<double>(Clock::now() - begin).count());
+        }
+        std::cout << (result ? "yes" : "no") << "; untraced " << untraced << " s; built without tracing, rebuild with "
+                  << "make clean && make TRACE=1 && make TRACE=1 tools to record" << std::endl;
+        return 0;
+    }
+    // Untraced and traced runs alternate, so that both see the same machine.
+    bool untraced_result = false, traced_result = false;
+    double untraced = 1e30, traced = 1e30;
+    for(int i = 0; i < reps; i++) {
+        Clock::time_point begin = Clock::now();
+        untraced_result = check();
+        untraced = std::min(untraced, std::chrono::duration<double>(Clock::now() - begin).count());
+
+        trace::clear();
+        trace::start(capacity);
+        begin = Clock::now();
+        traced_result = check();
+        traced = std::min(traced, std::chrono::duration<double>(Clock::now() - begin).count());
+        trace::stop();
+    }
+
+    std::ofstream out(out_path);
+    trace::write_chrome_json(out);
+    if(!out) {
+        std::cerr << "cannot write " << out_path << std::endl;
+        return 1;
+    }
+    std::cout << (traced_result ? "yes" : "no") << "; untraced " << untraced << " s, traced " << traced << " s ("
+              << (traced / untraced - 1) * 100 << "% overhead); wrote " << out_path << std::endl;
+    return untraced_result == traced_result ? 0 : 1;
+}